@@ -0,0 +1,256 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "itmoscript/interpreter.h"
+
+namespace {
+
+struct Benchmark {
+    std::string_view name;
+    std::string_view code;
+    // Worker threads for parallel builtins; 0 means one per core.
+    size_t workers = 0;
+};
+
+// A pure, call-heavy function mapped over a list, for parallel_map.
+constexpr std::string_view kCollatz = R"(
+    collatz = function(n)
+        steps = 0
+        while n != 1
+            if n % 2 == 0 then n = n / 2 else n = 3 * n + 1 end if
+            steps += 1
+        end while
+        return steps
+    end function
+    add = function(a, b) return a + b end function
+    println(reduce(parallel_map(range(1, 20000, 1), collatz), add))
+)";
+
+// Sorting by printed form goes parallel above a size threshold; the same
+// script is timed with one worker to show the speedup.
+constexpr std::string_view kSortLarge = R"(
+    lst = sort(range(0, 2000000, 1))
+    println(lst[1], " ", lst[1999999])
+)";
+
+// Each script prints a short checksum so that a broken optimization shows up
+// as a wrong result rather than a suspiciously fast run.
+constexpr Benchmark kBenchmarks[] = {
+    {"string_append", R"(
+        s = ""
+        i = 0
+        while i < 1000000
+            s += "abcdefghij"
+            i += 1
+        end while
+        println(len(s))
+    )"},
+    {"string_concat", R"(
+        s = ""
+        i = 0
+        while i < 1000000
+            s = s + "abcdefghij"
+            i += 1
+        end while
+        println(len(s))
+    )"},
+    {"list_push", R"(
+        lst = []
+        i = 0
+        while i < 1000000
+            lst = push(lst, i)
+            i += 1
+        end while
+        println(len(lst))
+    )"},
+    {"slice_recursion", R"(
+        total = function(a)
+            if len(a) <= 64 then
+                s = 0
+                i = 0
+                while i < len(a)
+                    s += a[i]
+                    i += 1
+                end while
+                return s
+            end if
+            mid = len(a) / 2
+            return total(a[:mid]) + total(a[mid:])
+        end function
+        println(total(range(0, 1000000, 1)))
+    )"},
+    {"int_hash", R"(
+        h = 0
+        i = 0
+        while i < 1000000
+            h = (h * 31 + i % 97) % 1000000007
+            i += 1
+        end while
+        println(h)
+    )"},
+    {"sort_by_field", R"(
+        recs = []
+        i = 0
+        while i < 1000000
+            recs = push(recs, [i, (i * 7919) % 1000003])
+            i += 1
+        end while
+        recs = sort_by(recs, function(r) return r[1] end function)
+        println(recs[0][0], " ", recs[999999][0])
+    )"},
+    {"map_loop", R"(
+        sq = function(x) return x * x end function
+        lst = range(0, 1000000, 1)
+        res = []
+        i = 0
+        while i < len(lst)
+            res = push(res, sq(lst[i]))
+            i += 1
+        end while
+        println(res[999999])
+    )"},
+    {"map_builtin", R"(
+        sq = function(x) return x * x end function
+        res = map(range(0, 1000000, 1), sq)
+        println(res[999999])
+    )"},
+    {"sum_loop", R"(
+        xs = mul(range(0, 1000000, 1), 0.5)
+        total = 0
+        i = 0
+        while i < 1000000
+            total = total + xs[i]
+            i = i + 1
+        end while
+        println(total)
+    )"},
+    {"sum_builtin", R"(
+        xs = mul(range(0, 1000000, 1), 0.5)
+        println(sum(xs), " ", max(xs), " ", dot(xs, xs))
+    )"},
+    {"versioned_update", R"(
+        v = map(range(0, 20000, 1), to_string)
+        prev = v
+        i = 0
+        while i < 5000
+            prev = v
+            v = set_at(push(v, "x"), i, "y")
+            i = i + 1
+        end while
+        println(len(prev), " ", len(v), " ", v[4999])
+    )"},
+    {"push_after_share", R"(
+        v = map(range(0, 20000, 1), to_string)
+        kept = v
+        i = 0
+        while i < 500000
+            v = push(v, "x")
+            v = set_at(v, i, "y")
+            i = i + 1
+        end while
+        println(len(kept), " ", len(v), " ", v[499999])
+    )"},
+    {"heap_push_pop", R"(
+        h = heap()
+        i = 0
+        while i < 200000
+            h = heap_push(h, [(i * 7919) % 100003, i])
+            i = i + 1
+        end while
+        total = 0
+        while len(h) > 0
+            total = total + heap_top(h)[0]
+            h = heap_pop(h)
+        end while
+        println(total)
+    )"},
+    {"deque_bfs", R"(
+        q = deque([0])
+        seen = 0
+        while len(q) > 0
+            v = q[0]
+            q = pop_front(q)
+            seen = seen + 1
+            if v < 500000 then q = push_back(q, 2 * v + 1) end if
+            if v < 500000 then q = push_back(q, 2 * v + 2) end if
+        end while
+        println(seen)
+    )"},
+    {"ordered_rank", R"(
+        s = ordered_set()
+        i = 0
+        total = 0
+        while i < 100000
+            k = (i * 7919) % 100003
+            s = ordered_insert(s, k)
+            total = total + ordered_rank(s, k)
+            if i % 3 == 0 then s = ordered_erase(s, ordered_at(s, 0)) end if
+            i = i + 1
+        end while
+        println(len(s), " ", total)
+    )"},
+    {"ordered_versions", R"(
+        s = ordered_set()
+        i = 0
+        while i < 20000
+            s = ordered_insert(s, i)
+            i = i + 1
+        end while
+        prev = s
+        while i < 40000
+            prev = s
+            s = ordered_insert(s, (i * 7919) % 100003)
+            i = i + 1
+        end while
+        println(len(prev), " ", len(s))
+    )"},
+    {"bisect_search", R"(
+        x = range(0, 1000000, 2)
+        i = 0
+        hits = 0
+        while i < 200000
+            hits = hits + bisect_left(x, (i * 7919) % 1000000)
+            i = i + 1
+        end while
+        println(hits)
+    )"},
+    {"parallel_map_1_worker", kCollatz, 1},
+    {"parallel_map", kCollatz},
+    {"sort_large_1_worker", kSortLarge, 1},
+    {"sort_large", kSortLarge},
+};
+
+}  // namespace
+
+/**
+ *  Runs every benchmark whose name contains the first argument (all of them
+ *  when none is given) and reports wall time per script.
+ */
+int main(int argc, char* argv[]) {
+    std::string_view filter = argc > 1 ? argv[1] : "";
+    bool ok = true;
+    for (const auto& b : kBenchmarks) {
+        if (b.name.find(filter) == std::string_view::npos) continue;
+
+        std::istringstream code{std::string(b.code)};
+        std::istringstream input;
+        std::ostringstream output;
+
+        auto start = std::chrono::steady_clock::now();
+        bool passed = itmoscript::interpret(
+            code, input, output, itmoscript::InterpreterOptions{b.workers});
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        auto ms =
+            std::chrono::duration<double, std::milli>(elapsed).count();
+        std::string result = output.str();
+        if (!result.empty() && result.back() == '\n') result.pop_back();
+        std::cout << b.name << ": " << ms << " ms"
+                  << (passed ? "" : " (FAILED)") << " -> " << result << "\n";
+        ok = ok && passed;
+    }
+    return ok ? 0 : 1;
+}
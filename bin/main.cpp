@@ -1,10 +1,21 @@
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include "itmoscript/ast.h"
+#include "itmoscript/hotspots.h"
+#include "itmoscript/interpreter.h"
 #include "itmoscript/lexer.h"
 #include "itmoscript/parser.h"
+#include "itmoscript/profiler.h"
+#include "itmoscript/statement_reader.h"
+#include "itmoscript/stats.h"
+#include "itmoscript/tracer.h"
 
 void printAST(const itmoscript::ASTNode* node, int indent = 0) {
     for (int i = 0; i < indent; ++i) std::cout << "  ";
@@ -12,17 +23,225 @@ void printAST(const itmoscript::ASTNode* node, int indent = 0) {
     for (const auto& child : node->children) printAST(child.get(), indent + 1);
 }
 
+void printStats() {
+    auto counts = itmoscript::stats::read();
+    for (size_t i = 0; i < counts.size(); ++i) {
+        auto c = static_cast<itmoscript::stats::Counter>(i);
+        std::cerr << itmoscript::stats::name(c) << ": " << counts[i] << "\n";
+    }
+}
+
+int usage(const char* self) {
+    std::cerr << "Usage: " << self
+              << " [--ast] [--workers N] [--profile FILE] [--hotspots]\n"
+              << "       [--stats] [--trace FILE [--trace-min-us N]]\n"
+              << "       [--max-ops N] [--max-time-ms N] [--max-depth N] "
+                 "[--max-heap-mb N]\n"
+              << "       [--load-snapshot FILE] [--save-snapshot FILE]\n"
+              << "       [--stream] <source_file | -> | --repl\n"
+              << "  -               read the program from standard input; "
+                 "read() then\n"
+              << "                  sees no input\n"
+              << "  --ast           print the syntax tree instead of running\n"
+              << "  --stream        run each top-level statement as soon as "
+                 "it is read\n"
+              << "  --repl          read statements typed at a prompt and "
+                 "run each one\n"
+              << "                  at once; errors do not end the session\n"
+              << "  --load-snapshot FILE  define the variables saved in FILE "
+                 "before running\n"
+              << "  --save-snapshot FILE  save the top-level variables to "
+                 "FILE after a\n"
+              << "                  successful run, for --load-snapshot\n"
+              << "  --workers N     threads for parallel builtins (default: "
+                 "one per core)\n"
+              << "  --profile FILE  sample the run; print a report to stderr "
+                 "and write\n"
+              << "                  folded stacks for flamegraphs to FILE\n"
+              << "  --hotspots      count executions and time per source "
+                 "line; print\n"
+              << "                  them to stderr, hottest first\n"
+              << "  --stats         print value copies, allocations and calls "
+                 "to stderr\n"
+              << "  --trace FILE    write a timeline of function calls to "
+                 "FILE as\n"
+              << "                  Chrome trace JSON, for Perfetto\n"
+              << "  --trace-min-us N  leave out calls shorter than N "
+                 "microseconds\n"
+              << "  --max-ops N, --max-time-ms N, --max-depth N, "
+                 "--max-heap-mb N\n"
+              << "                  stop the script, with exit status 2, "
+                 "when it makes\n"
+              << "                  more calls and loop iterations, runs "
+                 "longer, nests\n"
+              << "                  calls deeper or grows the heap more. "
+                 "The heap is\n"
+              << "                  that of the whole process, so memory "
+                 "that other\n"
+              << "                  threads allocate counts as well\n";
+    return 1;
+}
+
+// Parses a non-negative count; false when arg is not one.
+bool parseCount(const char* arg, unsigned long long& n) {
+    char* end = nullptr;
+    if (*arg == '-') return false;
+    n = std::strtoull(arg, &end, 10);
+    return *arg != '\0' && *end == '\0';
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>\n";
-        return 1;
+    bool astOnly = false;
+    bool repl = false;
+    itmoscript::InterpreterOptions options;
+    const char* path = nullptr;
+    const char* profilePath = nullptr;
+    bool hotspots = false;
+    bool showStats = false;
+    const char* tracePath = nullptr;
+    long traceMinUs = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--ast") {
+            astOnly = true;
+        } else if (arg == "--workers" && i + 1 < argc) {
+            char* end = nullptr;
+            long n = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || n < 1) return usage(argv[0]);
+            options.workers = static_cast<size_t>(n);
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (arg == "--hotspots") {
+            hotspots = true;
+        } else if (arg == "--stats") {
+            showStats = true;
+        } else if (arg == "--stream") {
+            options.streaming = true;
+        } else if (arg == "--repl") {
+            repl = true;
+        } else if (arg == "--load-snapshot" && i + 1 < argc) {
+            options.restoreSnapshot = argv[++i];
+        } else if (arg == "--save-snapshot" && i + 1 < argc) {
+            options.saveSnapshot = argv[++i];
+        } else if (arg.starts_with("--max-") && i + 1 < argc) {
+            unsigned long long n = 0;
+            if (!parseCount(argv[++i], n)) return usage(argv[0]);
+            auto& limits = options.limits;
+            if (arg == "--max-ops") {
+                limits.operations = n;
+            } else if (arg == "--max-time-ms") {
+                limits.wallTime = std::chrono::milliseconds(n);
+            } else if (arg == "--max-depth") {
+                limits.callDepth = n;
+            } else if (arg == "--max-heap-mb") {
+                limits.heapBytes = n << 20;
+            } else {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--trace-min-us" && i + 1 < argc) {
+            char* end = nullptr;
+            traceMinUs = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || traceMinUs < 0) return usage(argv[0]);
+        } else if (!path && (arg == "-" || !arg.starts_with("-"))) {
+            path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
     }
+    if (repl ? path || astOnly : !path) return usage(argv[0]);
 
-    std::ifstream in(argv[1]);
-    if (!in) {
-        std::cerr << "Cannot open file: " << argv[1] << "\n";
-        return 1;
+    bool fromStdin = repl || std::string_view(path) == "-";
+    std::ifstream file;
+    if (!fromStdin) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Cannot open file: " << path << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = fromStdin ? std::cin : file;
+    std::istringstream noInput;
+    std::istream& runtimeIn = fromStdin ? noInput : std::cin;
+
+    itmoscript::Hotspots counters;
+    if (hotspots) options.hotspots = &counters;
+    itmoscript::Tracer tracer{std::chrono::microseconds(traceMinUs)};
+    if (tracePath) options.tracer = &tracer;
+    // Writes the trace, if any, once the run is over.
+    auto writeTrace = [&] {
+        if (!tracePath) return true;
+        std::ofstream trace(tracePath);
+        tracer.writeJson(trace);
+        if (!trace) std::cerr << "Cannot write trace: " << tracePath << "\n";
+        return static_cast<bool>(trace);
+    };
+
+    // Reads and runs statements until the end of the input; the script's
+    // read() takes the lines in between. Errors, and breaches of the
+    // limits, end only the statement that caused them.
+    auto session = [&] {
+        itmoscript::Session session(std::cin, std::cout, options);
+        itmoscript::StatementReader reader(std::cin);
+        reader.setPrompt([](bool continued) {
+            std::cout << (continued ? "... " : "> ") << std::flush;
+        });
+        while (true) {
+            try {
+                if (session.run(reader)) break;
+            } catch (const itmoscript::LimitExceeded& e) {
+                std::cerr << e.what() << "\n";
+            }
+        }
+        if (std::cin.eof()) std::cout << "\n";
+        if (!options.saveSnapshot.empty()) session.save(options.saveSnapshot);
+    };
+
+    // Exit status of the run: 1 after a script error, 2 past a limit.
+    auto run = [&] {
+        try {
+            if (repl) {
+                session();
+                return 0;
+            }
+            bool ok = itmoscript::interpret(in, runtimeIn, std::cout, options);
+            return ok ? 0 : 1;
+        } catch (const itmoscript::LimitExceeded& e) {
+            std::cerr << e.what() << "\n";
+            return 2;
+        } catch (const std::runtime_error& e) {
+            // A REPL session that cannot start, e.g. from a bad snapshot.
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    };
+
+    if (!astOnly && profilePath) {
+        itmoscript::Profiler profiler;
+        options.profiler = &profiler;
+        int status = run();
+        profiler.writeReport(std::cerr);
+        if (hotspots) counters.writeReport(std::cerr);
+        if (showStats) printStats();
+        if (!writeTrace()) return 1;
+        std::ofstream folded(profilePath);
+        profiler.writeFolded(folded);
+        if (!folded) {
+            std::cerr << "Cannot write profile: " << profilePath << "\n";
+            return 1;
+        }
+        return status;
     }
+    if (!astOnly) {
+        int status = run();
+        if (hotspots) counters.writeReport(std::cerr);
+        if (showStats) printStats();
+        if (!writeTrace()) return 1;
+        return status;
+    }
+
     std::stringstream buffer;
     buffer << in.rdbuf();
     std::string source = buffer.str();
@@ -3,14 +3,17 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "itmoscript/ast.h"
+#include "itmoscript/symbol.h"
 #include "itmoscript/value.h"
 
 namespace itmoscript {
 
 class Environment;
-class ASTNode;
-using ASTNodePtr = std::unique_ptr<ASTNode>;
 
 class AETNode;
 using AETNodePtr = std::unique_ptr<AETNode>;
@@ -21,13 +24,66 @@ class AETNode {
     virtual Value execute(Environment& env) = 0;
 };
 
-struct ReturnException {
-    Value value;
+/**
+ *  Source spans of executable nodes. They live in this side table rather
+ *  than in the nodes, which keeps the nodes that run on every step small;
+ *  lookups only happen when an error is reported or a sample is taken.
+ */
+class SourceMap {
+   public:
+    void add(const AETNode* node, const SourceSpan& span) {
+        if (spans_.emplace(node, span).second) order_.push_back(node);
+    }
+    // The span of node, or nullptr when it has none.
+    const SourceSpan* find(const AETNode* node) const {
+        auto found = spans_.find(node);
+        return found == spans_.end() ? nullptr : &found->second;
+    }
+
+    // Marks the current contents; rollback() drops what was added since,
+    // e.g. the spans of a tree that is about to be destroyed.
+    size_t mark() const noexcept { return order_.size(); }
+    void rollback(size_t mark) {
+        for (size_t i = mark; i < order_.size(); ++i) spans_.erase(order_[i]);
+        order_.resize(mark);
+    }
+
+   private:
+    std::unordered_map<const AETNode*, SourceSpan> spans_;
+    std::vector<const AETNode*> order_;
+};
+
+// Records the span of every node it builds in spans when that is set.
+// Functions defined in ast share it, so it lives as long as they do.
+AETNodePtr buildAET(std::shared_ptr<const ASTNode> ast,
+                    SourceMap* spans = nullptr);
+
+/**
+ *  A script function value taken apart, e.g. to save it in a snapshot: the
+ *  syntax tree of its definition, the name it runs under in profiles and
+ *  traces, and the variables it captured.
+ */
+struct FunctionImage {
+    // Shared by all copies of one function value.
+    const void* id = nullptr;
+    // Shared by all functions made by one definition.
+    std::shared_ptr<const ASTNode> definition;
+    std::string label;
+    std::vector<std::pair<Symbol, Value>> captured;
 };
-struct BreakException {};
-struct ContinueException {};
 
-AETNodePtr buildAET(const ASTNode* ast);
+// Fills image from fn; false when fn is a builtin.
+bool imageOf(const Value& fn, FunctionImage& image);
+
+// Compiles the definition of a FunctionImage. One result can make any
+// number of function values.
+std::shared_ptr<const AETNode> buildFunction(
+    std::shared_ptr<const ASTNode> definition, const std::string& label);
+
+// A function value made by function, a result of buildFunction(), that
+// captured the given variables.
+Value functionFrom(const std::shared_ptr<const AETNode>& function,
+                   std::vector<std::pair<Symbol, Value>> captured);
 
 }  // namespace itmoscript
 
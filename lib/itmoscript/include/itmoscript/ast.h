@@ -32,11 +32,22 @@ enum class NodeType {
     Boolean
 };
 
+// Where a node came from in the source: 1-based line and column of its
+// first character and of the character after its last token. Line 0 means
+// unknown.
+struct SourceSpan {
+    int line = 0;
+    int column = 0;
+    int endLine = 0;
+    int endColumn = 0;
+};
+
 class ASTNode {
    public:
     NodeType type;
     std::string value;
     std::vector<std::unique_ptr<ASTNode>> children;
+    SourceSpan span;
 
     explicit ASTNode(NodeType type_, std::string value_ = "") noexcept
         : type(type_), value(std::move(value_)) {}
@@ -49,6 +60,16 @@ class ASTNode {
     void addChild(std::unique_ptr<ASTNode> child) {
         children.push_back(std::move(child));
     }
+
+    std::unique_ptr<ASTNode> clone() const {
+        auto copy = std::make_unique<ASTNode>(type, value);
+        copy->span = span;
+        copy->children.reserve(children.size());
+        for (const auto& child : children) {
+            copy->children.push_back(child->clone());
+        }
+        return copy;
+    }
 };
 
 using ASTNodePtr = std::unique_ptr<ASTNode>;
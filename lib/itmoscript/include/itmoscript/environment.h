@@ -1,65 +1,248 @@
 #ifndef ITMOSCRIPT_ENVIRONMENT_H
 #define ITMOSCRIPT_ENVIRONMENT_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <istream>
+#include <limits>
 #include <memory>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "itmoscript/aet.h"
+#include "itmoscript/hotspots.h"
+#include "itmoscript/limits.h"
+#include "itmoscript/profiler.h"
+#include "itmoscript/stats.h"
+#include "itmoscript/symbol.h"
+#include "itmoscript/thread_pool.h"
+#include "itmoscript/tracer.h"
 #include "itmoscript/value.h"
 
 namespace itmoscript {
 
+// Raised when code running in a forked environment tries to do I/O.
+class IsolationError : public std::runtime_error {
+   public:
+    using std::runtime_error::runtime_error;
+};
+
 class Environment {
    public:
     class Builder;
 
-    Value get(const std::string& name) const;
+    // Non-local exit requested by return, break or continue. Statement
+    // lists stop as soon as one is pending; the enclosing loop or function
+    // call consumes it.
+    enum class Unwind { None, Return, Break, Continue };
+
+    // Variables are keyed by interned names, so lookups hash and compare
+    // pointers rather than strings.
+    using Frame = std::unordered_map<Symbol, Value>;
+
+    Value get(Symbol name) const;
+
+    void set(Symbol name, Value val);
+
+    // Moves the value out of the innermost frame when it lives there, leaving
+    // nil behind; otherwise behaves like get(). Used for last uses of a
+    // variable that is about to be reassigned.
+    Value take(Symbol name);
+    // Undoes take(name) when the operation that consumed the value failed
+    // and handed it back. Does nothing when take() returned a copy.
+    void untake(Symbol name, Value value);
 
-    void set(const std::string& name, Value val);
+    // True when name resolves to a standard library global, i.e. no frame
+    // shadows it.
+    bool isBuiltin(Symbol name) const;
 
     void pushFrame();
     void popFrame();
 
-    std::ostream& out() const noexcept { return *out_; }
+    // Drops the frames and calls an error left behind, back to the top
+    // level, so that the environment can run more code.
+    void resetToTopLevel();
+    // Starts the limits over, with the full budget of operations, time
+    // and heap growth, e.g. for the next input after a breach.
+    void renewLimits() {
+        if (limits_.any()) applyLimits(limits_);
+    }
+
+    Unwind unwinding() const noexcept { return unwind_; }
+    void beginUnwind(Unwind kind, Value result = Value()) {
+        unwind_ = kind;
+        result_ = std::move(result);
+    }
+    // Clears the pending exit and hands back the value of a return.
+    Value endUnwind() {
+        unwind_ = Unwind::None;
+        return std::exchange(result_, Value());
+    }
 
-    std::istream& in() const noexcept { return *in_; }
+    std::ostream& out() const {
+        if (!out_) throw IsolationError("output is not available here");
+        return *out_;
+    }
 
-    void pushStack(const std::string& fnName) { callStack_.push_back(fnName); }
+    std::istream& in() const {
+        if (!in_) throw IsolationError("input is not available here");
+        return *in_;
+    }
+
+    // Independent environment for running code on a worker thread. It sees
+    // the current variables as one base frame and the same globals, and
+    // starts from a copy of the call stack, but has no I/O streams, no
+    // thread pool of its own and no profiler or hotspot counters. It
+    // traces into the same tracer, which keeps a buffer per thread, and
+    // runs under the same limits. Forks draw on one budget of operations,
+    // which they charge as they go and when they are destroyed.
+    std::unique_ptr<Environment> fork() const;
+    // Charges the operations of forks that have finished to this
+    // environment; throws LimitExceeded when they went over a limit.
+    void joinForks();
+    ~Environment();
+
+    // label names the frame in profiles and traces.
+    void pushStack(const std::string& fnName, Symbol label) {
+        stats::add(stats::Counter::Calls);
+        if (callStack_.size() >= maxDepth_) [[unlikely]] tooDeep();
+        step();
+        safepoint();
+        callStack_.push_back(fnName);
+        if (profiler_) profileStack_.push_back(&label.str());
+        if (tracer_) [[unlikely]] tracer_->enter(label);
+    }
     void popStack() {
+        safepoint();
         if (!callStack_.empty()) callStack_.pop_back();
+        if (profiler_ && !profileStack_.empty()) profileStack_.pop_back();
+        if (tracer_) [[unlikely]] tracer_->exit();
+    }
+
+    // Counts an operation (a call or a loop iteration) against the limits.
+    // The limits are checked only when a grant of fuel runs out.
+    void step() {
+        if (--fuel_ < 0) [[unlikely]] refuel();
+    }
+
+    // Throws LimitExceeded when count elements of size bytes would take
+    // the heap over its limit. Called before allocating buffers whose size
+    // a script picks, e.g. in range() and `*`, which could otherwise grow
+    // far past the limit before the heap is next checked.
+    void checkAllocation(std::uint64_t count, std::uint64_t size) const;
+
+    // Hands the call stack to the profiler when a sample is pending. Called
+    // on calls, returns and loop back edges.
+    void safepoint() {
+        if (profiler_ && profiler_->due()) {
+            const SourceSpan* at = location();
+            profiler_->sample(profileStack_, at ? at->line : 0);
+        }
+    }
+
+    // The statement being executed, innermost call first; set by statement
+    // lists and loops, restored by calls when they return.
+    const AETNode* statement() const noexcept { return statement_; }
+    void enterStatement(const AETNode* s) {
+        statement_ = s;
+        if (hotspots_) [[unlikely]] hotspots_->enter(s);
+    }
+    void resumeStatement(const AETNode* s) {
+        statement_ = s;
+        if (hotspots_) [[unlikely]] hotspots_->resume(s);
+    }
+    // Source span of the current statement, or nullptr when unknown.
+    const SourceSpan* location() const {
+        return sources_ && statement_ ? sources_->find(statement_) : nullptr;
     }
 
     const std::vector<std::string>& getCallStack() const noexcept {
         return callStack_;
     }
 
+    // Threads available to parallel builtins; the pool is started on first
+    // use. Returns nullptr when only one worker is configured.
+    ThreadPool* pool();
+
    private:
-    std::vector<std::unordered_map<std::string, Value>> frames_;
-    std::unordered_map<std::string, Value> globals_;
+    // Throws LimitExceeded if a limit is exceeded; else grants more fuel.
+    void refuel();
+    void grant();
+    // Counts n operations done since the last grant.
+    void charge(std::uint64_t n);
+    void checkLimits() const;
+    [[noreturn]] void tooDeep() const;
+    [[noreturn]] void outOfHeap() const;
+    void applyLimits(const Limits& limits);
+
+    std::vector<Frame> frames_;
+    // Popped frames, kept with their bucket arrays for the next call.
+    std::vector<Frame> spareFrames_;
+    Unwind unwind_ = Unwind::None;
+    Value result_;
+    Frame globals_;
     std::ostream* out_ = nullptr;
     std::istream* in_ = nullptr;
 
     std::vector<std::string> callStack_;
+    // Labels of the calls on callStack_, kept only while profiling.
+    std::vector<const std::string*> profileStack_;
+
+    size_t workers_ = 1;
+    std::unique_ptr<ThreadPool> pool_;
+    Profiler* profiler_ = nullptr;
+    Hotspots* hotspots_ = nullptr;
+    Tracer* tracer_ = nullptr;
+    const SourceMap* sources_ = nullptr;
+    const AETNode* statement_ = nullptr;
+
+    Limits limits_;
+    // Operations left before the limits are next checked, out of granted_.
+    std::int64_t fuel_ = std::numeric_limits<std::int64_t>::max();
+    std::int64_t granted_ = fuel_;
+    // Operations done before the current grant. In a fork, the operations
+    // of the parent and of all its forks.
+    std::uint64_t spent_ = 0;
+    // Operations of forks not yet charged here by joinForks().
+    mutable std::atomic<std::uint64_t> forkSpent_ = 0;
+    // Set in a fork: the parent's forkSpent_, and the parent's operations.
+    std::atomic<std::uint64_t>* parentSpent_ = nullptr;
+    std::uint64_t parentBase_ = 0;
+    size_t maxDepth_ = std::numeric_limits<size_t>::max();
+    std::chrono::steady_clock::time_point deadline_;
+    size_t heapBase_ = 0;
 
     friend class Builder;
 
    public:
-    const std::unordered_map<std::string, Value>& getLocals() const noexcept {
+    const Frame& getLocals() const noexcept {
         return frames_.back();
     }
+
+    // The standard library, by name.
+    const Frame& getGlobals() const noexcept { return globals_; }
 };
 
 class Environment::Builder {
-    std::unordered_map<std::string, Value> globals_;
+    Frame globals_;
     std::ostream* out_ = nullptr;
     std::istream* in_ = nullptr;
+    size_t workers_ = 1;
+    Profiler* profiler_ = nullptr;
+    Hotspots* hotspots_ = nullptr;
+    Tracer* tracer_ = nullptr;
+    const SourceMap* sources_ = nullptr;
+    Limits limits_;
 
    public:
-    Builder& addGlobal(std::string name, Value val) {
-        globals_.emplace(std::move(name), std::move(val));
+    Builder& addGlobal(std::string_view name, Value val) {
+        globals_.emplace(Symbol(name), std::move(val));
         return *this;
     }
 
@@ -73,14 +256,57 @@ class Environment::Builder {
         return *this;
     }
 
+    Builder& setWorkers(size_t workers) {
+        workers_ = workers;
+        return *this;
+    }
+
+    Builder& setProfiler(Profiler& profiler) {
+        profiler_ = &profiler;
+        return *this;
+    }
+
+    Builder& setHotspots(Hotspots& hotspots) {
+        hotspots_ = &hotspots;
+        return *this;
+    }
+
+    // Traces script calls, and builtin calls: build() wraps every function
+    // among the globals to record them.
+    Builder& setTracer(Tracer& tracer) {
+        tracer_ = &tracer;
+        return *this;
+    }
+
+    Builder& setLimits(const Limits& limits) {
+        limits_ = limits;
+        return *this;
+    }
+
+    // Locates errors and profile samples; see buildAET().
+    Builder& setSourceMap(const SourceMap& sources) {
+        sources_ = &sources;
+        return *this;
+    }
+
     std::unique_ptr<Environment> build() {
         auto env = std::make_unique<Environment>();
+        if (tracer_) traceBuiltins();
         env->globals_ = std::move(globals_);
         env->frames_.push_back({});
         env->out_ = out_;
         env->in_ = in_;
+        env->workers_ = workers_;
+        env->profiler_ = profiler_;
+        env->hotspots_ = hotspots_;
+        env->tracer_ = tracer_;
+        env->sources_ = sources_;
+        if (limits_.any()) env->applyLimits(limits_);
         return env;
     }
+
+   private:
+    void traceBuiltins();
 };
 
 }  // namespace itmoscript
@@ -0,0 +1,57 @@
+#ifndef ITMOSCRIPT_HEAP_H
+#define ITMOSCRIPT_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "itmoscript/value.h"
+
+namespace itmoscript {
+
+/**
+ *  Binary min-heap behind the heap value type. Each item is stored with its
+ *  key, computed once when it is pushed; keys are all numbers or all
+ *  strings. Items with equal keys come out in the order they went in.
+ */
+class Heap {
+   public:
+    // keyFn is nil when items are ordered by themselves, or by the first
+    // element of [priority, payload] lists.
+    explicit Heap(Value keyFn = Value()) : keyFn_(std::move(keyFn)) {}
+
+    const Value& keyFunction() const noexcept { return keyFn_; }
+    size_t size() const noexcept { return entries_.size(); }
+    bool empty() const noexcept { return entries_.empty(); }
+
+    const Value& top() const { return entries_.front().item; }
+    void push(Value item, Value key);
+    void pop();
+
+    // The items in the order pop() would return them.
+    std::vector<Value> ordered() const;
+    // The same, each with its key: [key, item] pairs.
+    std::vector<std::pair<Value, Value>> keyed() const;
+
+   private:
+    struct Entry {
+        Value key;
+        Value item;
+        std::uint64_t seq;
+    };
+
+    // Whether a pops after b: std heap algorithms keep the maximum of this
+    // order on top, which is the entry that pops first.
+    static bool after(const Entry& a, const Entry& b);
+    // The entries in pop order.
+    std::vector<Entry> sorted() const;
+
+    std::vector<Entry> entries_;
+    Value keyFn_;
+    std::uint64_t nextSeq_ = 0;
+};
+
+}  // namespace itmoscript
+
+#endif
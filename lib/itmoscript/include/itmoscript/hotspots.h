@@ -0,0 +1,73 @@
+#ifndef ITMOSCRIPT_HOTSPOTS_H
+#define ITMOSCRIPT_HOTSPOTS_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace itmoscript {
+
+class AETNode;
+class SourceMap;
+
+/**
+ *  Exact per-statement counters, like gcov for scripts. The interpreter
+ *  reports every statement it starts and every return into a caller's
+ *  statement; each statement is credited with its executions and with the
+ *  time until the next switch (its self time, excluding the statements it
+ *  calls). Only the interpreter thread records.
+ */
+class Hotspots {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // Statement s starts executing.
+    void enter(const AETNode* s) {
+        switchTo(s);
+        ++nodes_[s].count;
+    }
+    // Execution continues in s, e.g. after a call made from it returns.
+    void resume(const AETNode* s) { switchTo(s); }
+
+    // Folds the counters gathered so far into per-line totals, using
+    // sources to map statements to lines, and takes the text of the lines
+    // from source, the script text from line firstLine on. Must be called
+    // before the executed tree is destroyed; totals accumulate across runs.
+    // Lines outside source get their text from a later call covering them.
+    void attribute(const SourceMap& sources, std::string_view source,
+                   int firstLine = 1);
+
+    // One line per executed source line, by self time, then count:
+    // "count  ms  time%  line: text".
+    void writeReport(std::ostream& os) const;
+
+   private:
+    void switchTo(const AETNode* s) {
+        auto now = Clock::now();
+        if (current_) nodes_[current_].time += now - since_;
+        current_ = s;
+        since_ = now;
+    }
+
+    struct Counts {
+        std::uint64_t count = 0;
+        Clock::duration time{};
+    };
+    struct Line {
+        Counts counts;
+        std::string text;
+    };
+
+    std::unordered_map<const AETNode*, Counts> nodes_;
+    const AETNode* current_ = nullptr;
+    Clock::time_point since_;
+    std::map<int, Line> lines_;
+};
+
+}  // namespace itmoscript
+
+#endif
@@ -1,16 +1,88 @@
 #ifndef ITMOSCRIPT_INTERPRETER_H
 #define ITMOSCRIPT_INTERPRETER_H
 
+#include <cstddef>
 #include <istream>
+#include <memory>
 #include <ostream>
+#include <string>
+
+#include "itmoscript/limits.h"
 
 namespace itmoscript {
 
+class Hotspots;
+class Profiler;
+class StatementReader;
+class Tracer;
+
+struct InterpreterOptions {
+    // Threads used by parallel builtins such as sort on large lists; 0 means
+    // one per hardware thread.
+    size_t workers = 0;
+    // Samples the script while it runs when set; see Profiler.
+    Profiler* profiler = nullptr;
+    // Counts executions and time per statement when set; see Hotspots.
+    Hotspots* hotspots = nullptr;
+    // Records a timeline of script and builtin calls when set; see Tracer.
+    Tracer* tracer = nullptr;
+    // Bounds for untrusted code; exceeding one throws LimitExceeded.
+    Limits limits;
+    // Executes each top-level statement as soon as it has been read rather
+    // than reading the whole program first, e.g. for programs piped in
+    // while they are being generated. Statements before a syntax error
+    // have already run when it is found.
+    bool streaming = false;
+    // Snapshot file whose variables are defined before the program runs,
+    // e.g. tables built by an earlier run's setup; see snapshot::load().
+    std::string restoreSnapshot;
+    // File to save the top-level variables to once the program has run
+    // without errors.
+    std::string saveSnapshot;
+};
+
 bool interpret(std::istream& in, std::ostream& out);
 
 bool interpret(std::istream& codeIn, std::istream& runtimeIn,
                std::ostream& out);
 
+// Reports script errors to stderr and returns false; a breach of
+// options.limits is thrown as LimitExceeded instead.
+bool interpret(std::istream& codeIn, std::istream& runtimeIn,
+               std::ostream& out, const InterpreterOptions& options);
+
+/**
+ *  An environment that outlives a single program: each call of run()
+ *  builds and executes only the statements it reads, which see the
+ *  variables and functions left by earlier calls. The standard library is
+ *  set up once. Backs streaming runs and the REPL.
+ */
+class Session {
+   public:
+    Session(std::istream& runtimeIn, std::ostream& out,
+            const InterpreterOptions& options = {});
+    // Stops the profiler and settles the hotspot counts.
+    ~Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // Executes statements from reader until its input ends or a top-level
+    // return. Errors are reported to stderr and return false; the session
+    // then drops the calls in progress and can go on. A breach of the
+    // limits is thrown as LimitExceeded, after the same cleanup and with
+    // the limits started over, so a REPL can report it and go on too.
+    bool run(StatementReader& reader);
+    bool run(std::istream& code);
+
+    // Saves the session's top-level variables; see snapshot::save().
+    void save(const std::string& path) const;
+
+   private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
 }  // namespace itmoscript
 
 #endif
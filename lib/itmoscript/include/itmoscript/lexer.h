@@ -10,7 +10,9 @@ namespace itmoscript {
 
 class Lexer {
    public:
-    explicit Lexer(const std::string& source) noexcept;
+    // firstLine is the line number of the start of source, for sources
+    // that are part of a larger text.
+    explicit Lexer(const std::string& source, int firstLine = 1) noexcept;
     std::vector<Token> tokenize();
 
    private:
@@ -0,0 +1,48 @@
+#ifndef ITMOSCRIPT_LIMITS_H
+#define ITMOSCRIPT_LIMITS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace itmoscript {
+
+// Bounds on a run of untrusted code; zero means no bound.
+struct Limits {
+    // Operations are calls of script functions and loop iterations.
+    std::uint64_t operations = 0;
+    std::chrono::milliseconds wallTime{0};
+    size_t callDepth = 0;
+    // Growth of the process heap during the run. Checked together with
+    // the wall time, so a single builtin call may overshoot it. The heap
+    // is measured for the whole process, not per interpreter: whatever
+    // other threads and interpreters allocate meanwhile counts against
+    // it, and whatever they free makes room.
+    size_t heapBytes = 0;
+
+    bool any() const noexcept {
+        return operations || wallTime.count() || callDepth || heapBytes;
+    }
+};
+
+// Raised when a run exceeds one of its Limits. interpret() lets it through
+// rather than reporting it like a script error, so the embedder can tell
+// the two apart.
+class LimitExceeded : public std::runtime_error {
+   public:
+    enum class Kind { Operations, WallTime, CallDepth, HeapBytes };
+
+    LimitExceeded(Kind kind, const std::string& what)
+        : std::runtime_error(what), kind_(kind) {}
+
+    Kind kind() const noexcept { return kind_; }
+
+   private:
+    Kind kind_;
+};
+
+}  // namespace itmoscript
+
+#endif
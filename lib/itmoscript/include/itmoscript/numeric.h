@@ -0,0 +1,77 @@
+#ifndef ITMOSCRIPT_NUMERIC_H
+#define ITMOSCRIPT_NUMERIC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace itmoscript {
+
+// Checked int64 arithmetic; each returns true when the result overflowed.
+inline bool addOverflow(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(a, b, &r);
+#else
+    using lim = std::numeric_limits<std::int64_t>;
+    if ((b > 0 && a > lim::max() - b) || (b < 0 && a < lim::min() - b))
+        return true;
+    r = a + b;
+    return false;
+#endif
+}
+
+inline bool subOverflow(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(a, b, &r);
+#else
+    using lim = std::numeric_limits<std::int64_t>;
+    if ((b < 0 && a > lim::max() + b) || (b > 0 && a < lim::min() + b))
+        return true;
+    r = a - b;
+    return false;
+#endif
+}
+
+inline bool mulOverflow(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(a, b, &r);
+#else
+    using lim = std::numeric_limits<std::int64_t>;
+    if (a != 0 && b != 0) {
+        if (a > 0 ? (b > 0 ? a > lim::max() / b : b < lim::min() / a)
+                  : (b > 0 ? a < lim::min() / b
+                           : a < lim::max() / b))
+            return true;
+    }
+    r = a * b;
+    return false;
+#endif
+}
+
+/**
+ *  Loops over contiguous doubles behind the numeric list builtins. On x86-64
+ *  they use AVX2 when the CPU has it and a portable loop otherwise; the
+ *  reductions split the work across several accumulators, so their results
+ *  may differ from a left-to-right sum in the last bits.
+ */
+namespace kernels {
+
+double sum(std::span<const double> xs);
+double dot(std::span<const double> a, std::span<const double> b);
+
+// Position of the first smallest / largest element; xs must not be empty.
+size_t argmin(std::span<const double> xs);
+size_t argmax(std::span<const double> xs);
+
+// Elementwise out[i] = a[i] + b[i] and out[i] = a[i] * b[i].
+void add(std::span<const double> a, std::span<const double> b,
+         std::span<double> out);
+void mul(std::span<const double> a, std::span<const double> b,
+         std::span<double> out);
+
+}  // namespace kernels
+
+}  // namespace itmoscript
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef ITMOSCRIPT_ORDERED_MAP_H
+#define ITMOSCRIPT_ORDERED_MAP_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "itmoscript/value.h"
+
+namespace itmoscript {
+
+/**
+ *  B+-tree behind the ordered set and map value types. Keys are all numbers
+ *  or all strings, ordered as by compareKeys(); entries live in the leaves
+ *  and every inner node counts the entries below each child, so lookups by
+ *  key and by position (rank, k-th entry) both take O(log n). Copies share
+ *  nodes until one of them changes, which copies only the path it walks,
+ *  so copying a map is O(1) and each copy-on-write update O(log n).
+ */
+class OrderedMap {
+   public:
+    struct Entry {
+        Value key;
+        Value value;
+    };
+
+    // A set stores keys only; its entries have nil values.
+    explicit OrderedMap(bool isSet);
+    OrderedMap(const OrderedMap& other);
+    OrderedMap(OrderedMap&& other) noexcept;
+    OrderedMap& operator=(const OrderedMap&) = delete;
+    ~OrderedMap();
+
+    bool isSet() const noexcept { return isSet_; }
+    size_t size() const noexcept;
+
+    // Adds key, or replaces the value stored under it; false if the key was
+    // already present.
+    bool insert(Value key, Value value);
+    // False if the key was not present.
+    bool erase(const Value& key);
+
+    const Entry* find(const Value& key) const;
+    // Number of keys less than key.
+    size_t rank(const Value& key) const;
+    // The entry at position i in key order; i < size().
+    const Entry& at(size_t i) const;
+
+    // What scripts see of an entry: the key of a set, [key, value] of a map.
+    Value element(const Entry& e) const;
+    // The elements of all entries in key order.
+    std::vector<Value> elements() const;
+
+   private:
+    struct Node;
+
+    std::shared_ptr<Node> root_;
+    bool isSet_;
+};
+
+}  // namespace itmoscript
+
+#endif
@@ -30,6 +30,12 @@ class Parser {
     bool check(TokenType type) const noexcept;
     void expect(TokenType type, const std::string& message);
 
+    // Gives n the span from tokens_[first] to the last token read, not
+    // counting trailing newlines.
+    ASTNodePtr finish(ASTNodePtr n, size_t first) const;
+    // A node for the single token tok.
+    static ASTNodePtr leaf(NodeType type, const Token& tok);
+
     ASTNodePtr parseStatementList();
     ASTNodePtr parseStatement();
     ASTNodePtr parseSimpleStatement();
@@ -51,11 +57,15 @@ class Parser {
     ASTNodePtr parseLogicalAnd();
     ASTNodePtr parseLogicalNot();
     ASTNodePtr parseComparison();
+    ASTNodePtr parseBitOr();
+    ASTNodePtr parseBitXor();
+    ASTNodePtr parseBitAnd();
+    ASTNodePtr parseShift();
     ASTNodePtr parseAdditive();
     ASTNodePtr parseMultiplicative();
     ASTNodePtr parseExponent();
     ASTNodePtr parseUnary();
-    ASTNodePtr parsePostfix(ASTNodePtr lhs);
+    ASTNodePtr parsePostfix(ASTNodePtr lhs, size_t first);
     ASTNodePtr parsePrimary();
     ASTNodePtr parseLiteral();
 
@@ -0,0 +1,332 @@
+#ifndef ITMOSCRIPT_PERSISTENT_VECTOR_H
+#define ITMOSCRIPT_PERSISTENT_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace itmoscript {
+
+/**
+ *  Immutable sequence stored as a B+-tree of small leaves, in which every
+ *  inner node records the running sizes of its children (a relaxed radix
+ *  tree). Updates copy only the path to the touched leaf and return a new
+ *  vector that shares everything else with the old one, so indexing, set,
+ *  insert, erase, concatenation and slicing all take O(log n) time.
+ *  update and append change the vector itself, in place along the paths
+ *  that no other vector shares.
+ */
+template <typename T>
+class PersistentVector {
+   public:
+    // Most elements per leaf and children per inner node.
+    static constexpr size_t kBranch = 32;
+
+    PersistentVector() = default;
+
+    template <typename It>
+    PersistentVector(It first, It last);
+
+    size_t size() const noexcept { return root_ ? root_->size : 0; }
+    bool empty() const noexcept { return !root_; }
+
+    const T& operator[](size_t i) const;
+
+    // The leaf holding element i; start is set to the index of its first
+    // element. Lets iteration walk a leaf at a time.
+    std::span<const T> leafAt(size_t i, size_t& start) const;
+
+    PersistentVector set(size_t i, T v) const;
+    PersistentVector insert(size_t i, T v) const;
+    PersistentVector erase(size_t i) const;
+    PersistentVector pushBack(T v) const;
+    // Elements [from, to).
+    PersistentVector slice(size_t from, size_t to) const;
+    static PersistentVector concat(const PersistentVector& a,
+                                   const PersistentVector& b);
+
+    // As set and pushBack, applied to this vector.
+    void update(size_t i, T v);
+    void append(T v);
+
+   private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    // Leaves (height 0) hold items; inner nodes hold kids, all of the same
+    // height, with ends[k] the number of elements in kids[0..k].
+    struct Node {
+        size_t height = 0;
+        size_t size = 0;
+        std::vector<T> items;
+        std::vector<NodePtr> kids;
+        std::vector<size_t> ends;
+    };
+
+    explicit PersistentVector(NodePtr root) : root_(trimmed(std::move(root))) {}
+
+    // Every node is made non-const by make_shared, so one held by a single
+    // pointer, under parents that are as well, may be changed in place.
+    static Node& edit(const NodePtr& n) { return const_cast<Node&>(*n); }
+
+    static NodePtr makeLeaf(std::vector<T> items);
+    static NodePtr makeInner(std::vector<NodePtr> kids);
+    static NodePtr trimmed(NodePtr n);
+    static size_t childAt(const Node& n, size_t& i);
+
+    static std::vector<NodePtr> pair(const NodePtr& a, const NodePtr& b);
+    static std::vector<NodePtr> group(std::vector<NodePtr> kids);
+    static std::vector<NodePtr> joinRight(const NodePtr& a, const NodePtr& b);
+    static std::vector<NodePtr> joinLeft(const NodePtr& a, const NodePtr& b);
+    static NodePtr join(const NodePtr& a, const NodePtr& b);
+    static std::pair<NodePtr, NodePtr> split(const NodePtr& n, size_t i);
+    static NodePtr assign(const NodePtr& n, size_t i, T v, bool owned);
+
+    NodePtr root_;
+};
+
+template <typename T>
+template <typename It>
+PersistentVector<T>::PersistentVector(It first, It last) {
+    std::vector<NodePtr> level;
+    while (first != last) {
+        std::vector<T> items;
+        items.reserve(kBranch);
+        for (; first != last && items.size() < kBranch; ++first) {
+            items.push_back(*first);
+        }
+        level.push_back(makeLeaf(std::move(items)));
+    }
+    while (level.size() > 1) {
+        std::vector<NodePtr> up;
+        for (size_t k = 0; k < level.size(); k += kBranch) {
+            size_t end = std::min(level.size(), k + kBranch);
+            up.push_back(makeInner({level.begin() + k, level.begin() + end}));
+        }
+        level.swap(up);
+    }
+    if (!level.empty()) root_ = std::move(level[0]);
+}
+
+template <typename T>
+auto PersistentVector<T>::makeLeaf(std::vector<T> items) -> NodePtr {
+    if (items.empty()) return nullptr;
+    auto n = std::make_shared<Node>();
+    n->size = items.size();
+    n->items = std::move(items);
+    return n;
+}
+
+template <typename T>
+auto PersistentVector<T>::makeInner(std::vector<NodePtr> kids) -> NodePtr {
+    if (kids.empty()) return nullptr;
+    auto n = std::make_shared<Node>();
+    n->height = kids[0]->height + 1;
+    n->ends.reserve(kids.size());
+    for (const auto& kid : kids) {
+        n->size += kid->size;
+        n->ends.push_back(n->size);
+    }
+    n->kids = std::move(kids);
+    return n;
+}
+
+// Drops inner nodes with a single child from the top of a tree.
+template <typename T>
+auto PersistentVector<T>::trimmed(NodePtr n) -> NodePtr {
+    while (n && n->height > 0 && n->kids.size() == 1) n = n->kids[0];
+    return n;
+}
+
+// Index of the child holding element i; i becomes the offset within it.
+template <typename T>
+size_t PersistentVector<T>::childAt(const Node& n, size_t& i) {
+    size_t k = std::upper_bound(n.ends.begin(), n.ends.end(), i) -
+               n.ends.begin();
+    if (k > 0) i -= n.ends[k - 1];
+    return k;
+}
+
+template <typename T>
+const T& PersistentVector<T>::operator[](size_t i) const {
+    const Node* n = root_.get();
+    while (n->height > 0) n = n->kids[childAt(*n, i)].get();
+    return n->items[i];
+}
+
+template <typename T>
+std::span<const T> PersistentVector<T>::leafAt(size_t i, size_t& start) const {
+    const Node* n = root_.get();
+    start = i;
+    while (n->height > 0) n = n->kids[childAt(*n, i)].get();
+    start -= i;
+    return n->items;
+}
+
+// Two nodes of the same height side by side: one node when their contents
+// fit into one, so that repeated joins do not leave a trail of tiny nodes.
+template <typename T>
+auto PersistentVector<T>::pair(const NodePtr& a, const NodePtr& b)
+    -> std::vector<NodePtr> {
+    if (a->height == 0 && a->items.size() + b->items.size() <= kBranch) {
+        std::vector<T> items;
+        items.reserve(a->items.size() + b->items.size());
+        items.insert(items.end(), a->items.begin(), a->items.end());
+        items.insert(items.end(), b->items.begin(), b->items.end());
+        return {makeLeaf(std::move(items))};
+    }
+    if (a->height > 0 && a->kids.size() + b->kids.size() <= kBranch) {
+        std::vector<NodePtr> kids = a->kids;
+        kids.insert(kids.end(), b->kids.begin(), b->kids.end());
+        return {makeInner(std::move(kids))};
+    }
+    return {a, b};
+}
+
+// Children of one level under one parent, or two when there are too many.
+template <typename T>
+auto PersistentVector<T>::group(std::vector<NodePtr> kids)
+    -> std::vector<NodePtr> {
+    if (kids.size() <= kBranch) return {makeInner(std::move(kids))};
+    auto mid = kids.begin() + kids.size() / 2;
+    return {makeInner({kids.begin(), mid}), makeInner({mid, kids.end()})};
+}
+
+// Hangs the lower tree b off the right edge of a at b's height.
+template <typename T>
+auto PersistentVector<T>::joinRight(const NodePtr& a, const NodePtr& b)
+    -> std::vector<NodePtr> {
+    const NodePtr& last = a->kids.back();
+    auto pieces =
+        last->height == b->height ? pair(last, b) : joinRight(last, b);
+    std::vector<NodePtr> kids(a->kids.begin(), a->kids.end() - 1);
+    kids.insert(kids.end(), pieces.begin(), pieces.end());
+    return group(std::move(kids));
+}
+
+// Hangs the lower tree a off the left edge of b at a's height.
+template <typename T>
+auto PersistentVector<T>::joinLeft(const NodePtr& a, const NodePtr& b)
+    -> std::vector<NodePtr> {
+    const NodePtr& first = b->kids.front();
+    auto pieces =
+        first->height == a->height ? pair(a, first) : joinLeft(a, first);
+    pieces.insert(pieces.end(), b->kids.begin() + 1, b->kids.end());
+    return group(std::move(pieces));
+}
+
+template <typename T>
+auto PersistentVector<T>::join(const NodePtr& a, const NodePtr& b)
+    -> NodePtr {
+    if (!a) return b;
+    if (!b) return a;
+    auto top = a->height == b->height ? pair(a, b)
+               : a->height > b->height ? joinRight(a, b)
+                                       : joinLeft(a, b);
+    return top.size() == 1 ? top[0] : makeInner(std::move(top));
+}
+
+// The first i elements of n and the rest, either of which may be empty.
+template <typename T>
+auto PersistentVector<T>::split(const NodePtr& n, size_t i)
+    -> std::pair<NodePtr, NodePtr> {
+    if (!n || i == 0) return {nullptr, n};
+    if (i >= n->size) return {n, nullptr};
+    if (n->height == 0) {
+        auto mid = n->items.begin() + i;
+        return {makeLeaf({n->items.begin(), mid}),
+                makeLeaf({mid, n->items.end()})};
+    }
+    size_t k = childAt(*n, i);
+    auto [l, r] = split(n->kids[k], i);
+    auto before = trimmed(makeInner({n->kids.begin(), n->kids.begin() + k}));
+    auto after = trimmed(makeInner({n->kids.begin() + k + 1, n->kids.end()}));
+    return {join(before, trimmed(l)), join(trimmed(r), after)};
+}
+
+// n with element i replaced; n itself when owned, that is when nothing
+// outside this vector can reach it.
+template <typename T>
+auto PersistentVector<T>::assign(const NodePtr& n, size_t i, T v, bool owned)
+    -> NodePtr {
+    owned = owned && n.use_count() == 1;
+    NodePtr out = owned ? n : std::make_shared<Node>(*n);
+    Node& node = edit(out);
+    if (node.height == 0) {
+        node.items[i] = std::move(v);
+    } else {
+        size_t k = childAt(node, i);
+        node.kids[k] = assign(node.kids[k], i, std::move(v), owned);
+    }
+    return out;
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::set(size_t i, T v) const {
+    return PersistentVector(assign(root_, i, std::move(v), false));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::insert(size_t i, T v) const {
+    auto [l, r] = split(root_, i);
+    std::vector<T> one;
+    one.push_back(std::move(v));
+    return PersistentVector(join(join(l, makeLeaf(std::move(one))), r));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::erase(size_t i) const {
+    auto [l, rest] = split(root_, i);
+    return PersistentVector(join(l, split(rest, 1).second));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::pushBack(T v) const {
+    return insert(size(), std::move(v));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::slice(size_t from, size_t to) const {
+    return PersistentVector(split(split(root_, to).first, from).second);
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::concat(const PersistentVector& a,
+                                                const PersistentVector& b) {
+    return PersistentVector(join(a.root_, b.root_));
+}
+
+template <typename T>
+void PersistentVector<T>::update(size_t i, T v) {
+    root_ = assign(root_, i, std::move(v), true);
+}
+
+template <typename T>
+void PersistentVector<T>::append(T v) {
+    // Grows the last leaf when this vector alone holds the right edge and
+    // the leaf has room, as a flat list would; joins a new leaf otherwise.
+    const NodePtr* p = &root_;
+    while (*p && p->use_count() == 1 && (*p)->height > 0) {
+        p = &(*p)->kids.back();
+    }
+    if (!*p || p->use_count() != 1 || (*p)->items.size() == kBranch) {
+        *this = pushBack(std::move(v));
+        return;
+    }
+    for (Node* n = &edit(root_);; n = &edit(n->kids.back())) {
+        ++n->size;
+        if (n->height == 0) {
+            n->items.push_back(std::move(v));
+            return;
+        }
+        ++n->ends.back();
+    }
+}
+
+}  // namespace itmoscript
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ITMOSCRIPT_PROFILER_H
+#define ITMOSCRIPT_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace itmoscript {
+
+/**
+ *  Sampling profiler for the script call stack. A timer thread ticks once
+ *  per interval; the interpreter checks for a pending tick at calls,
+ *  returns and loop back edges and records its call stack and source line
+ *  there, weighted by the ticks that elapsed. Time spent inside a builtin
+ *  is charged to the stack seen at the next such point, which is the
+ *  caller's.
+ */
+class Profiler {
+   public:
+    explicit Profiler(
+        std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Starts and stops the timer thread; samples accumulate across runs.
+    void start();
+    void stop();
+
+    // Whether a tick is waiting to be recorded; cheap enough to call at
+    // every call and loop iteration.
+    bool due() const noexcept {
+        return ticks_.load(std::memory_order_relaxed) != seen_;
+    }
+    // Records stack (outermost call first), executing line (0 if unknown),
+    // for the pending ticks. Only the interpreter thread calls this.
+    void sample(const std::vector<const std::string*>& stack, int line);
+
+    std::uint64_t samples() const noexcept { return seen_; }
+
+    // Per function: self samples (at the top of the stack) and total
+    // samples (anywhere on it); then self samples per source line. Hottest
+    // first.
+    void writeReport(std::ostream& os) const;
+    // One "main;f;g count" line per distinct stack, the input format of
+    // flamegraph.pl and speedscope.
+    void writeFolded(std::ostream& os) const;
+
+   private:
+    void tick();
+
+    std::chrono::microseconds interval_;
+    std::atomic<std::uint64_t> ticks_{0};
+    std::uint64_t seen_ = 0;
+    // Orders stacks of strings and of string views alike, so a sample is
+    // looked up without copying its names.
+    struct StackLess {
+        using is_transparent = void;
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(),
+                                                b.end());
+        }
+    };
+
+    struct Samples {
+        std::uint64_t count = 0;
+        std::map<int, std::uint64_t> byLine;
+    };
+
+    std::map<std::vector<std::string>, Samples, StackLess> stacks_;
+    std::vector<std::string_view> scratch_;
+
+    std::thread timer_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+}  // namespace itmoscript
+
+#endif
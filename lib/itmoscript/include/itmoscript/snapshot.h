@@ -0,0 +1,43 @@
+#ifndef ITMOSCRIPT_SNAPSHOT_H
+#define ITMOSCRIPT_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+
+namespace itmoscript {
+
+class Environment;
+
+}  // namespace itmoscript
+
+namespace itmoscript::snapshot {
+
+/**
+ *  Saved variables of an environment, for scripts that spend a while
+ *  setting up tables before their real work: a later run restores them
+ *  from a file instead of running the setup again, much like a startup
+ *  snapshot of a JavaScript engine. The format holds no pointers. Strings,
+ *  lists and containers that several values share are stored once and are
+ *  shared again when restored. Script functions are stored as the syntax
+ *  trees of their definitions with the variables they captured, and are
+ *  compiled again on restore; builtins are stored by name. Streams, the
+ *  call stack and instruments are not part of a snapshot.
+ */
+
+// The variables of env's current frame, which is the top level between
+// statements. Throws std::runtime_error when one holds a function that
+// cannot be saved, e.g. a builtin that is not a global.
+std::string capture(const Environment& env);
+
+// Defines the variables saved in bytes in env's current frame. Throws
+// std::runtime_error when bytes are not a snapshot.
+void restore(std::string_view bytes, Environment& env);
+
+void save(const Environment& env, const std::string& path);
+// Maps the file into memory where the platform allows and restores from
+// the mapping.
+void load(const std::string& path, Environment& env);
+
+}  // namespace itmoscript::snapshot
+
+#endif
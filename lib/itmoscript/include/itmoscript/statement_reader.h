@@ -0,0 +1,53 @@
+#ifndef ITMOSCRIPT_STATEMENT_READER_H
+#define ITMOSCRIPT_STATEMENT_READER_H
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "itmoscript/ast.h"
+#include "itmoscript/token.h"
+
+namespace itmoscript {
+
+/**
+ *  Reads a program from a stream one top-level statement at a time, so the
+ *  statements can run while the rest is still being written. Lines are
+ *  lexed as they arrive; a statement is complete at the end of a line that
+ *  closes every block and list literal it opened and no string. Only the
+ *  pending statement is kept in memory.
+ */
+class StatementReader {
+   public:
+    explicit StatementReader(std::istream& in) : in_(in) {}
+
+    // Called before each line is read, with whether the line continues a
+    // statement; lets a REPL print its prompts.
+    void setPrompt(std::function<void(bool continued)> prompt) {
+        prompt_ = std::move(prompt);
+    }
+
+    // A Program node holding the statements completed by the next lines,
+    // or nullptr at the end of the input. Throws on lexing and parse
+    // errors.
+    ASTNodePtr next();
+
+    // The source lines of the last statement returned, and the number of
+    // the first of them.
+    const std::string& text() const noexcept { return text_; }
+    int firstLine() const noexcept { return firstLine_; }
+
+   private:
+    std::istream& in_;
+    std::function<void(bool)> prompt_;
+    int line_ = 0;
+    std::string text_;
+    int firstLine_ = 1;
+    std::vector<Token> tokens_;
+};
+
+}  // namespace itmoscript
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ITMOSCRIPT_STATS_H
+#define ITMOSCRIPT_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace itmoscript::stats {
+
+/**
+ *  Process-wide counters of what the interpreter spends its time on. Each
+ *  thread counts into a block of its own, so counting is a plain add with
+ *  no contention; reading sums the blocks of all threads, live and
+ *  finished.
+ */
+enum class Counter {
+    ValueCopies,
+    StringBuffers,
+    ListBuffers,
+    // Sizes of string and list buffers when created; growth in place is
+    // not counted.
+    BufferBytes,
+    FramePushes,
+    // Calls of script functions, including those made by builtins.
+    Calls,
+};
+
+inline constexpr size_t kCounters = 6;
+
+// Name of c as reported by stats(), e.g. "value_copies".
+std::string_view name(Counter c);
+
+using Snapshot = std::array<std::uint64_t, kCounters>;
+
+// Totals over all threads so far.
+Snapshot read();
+
+namespace detail {
+
+struct Block {
+    std::array<std::atomic<std::uint64_t>, kCounters> counts{};
+};
+
+// The calling thread's block; registered on first use.
+Block& registerThread();
+
+inline thread_local Block* local = nullptr;
+
+}  // namespace detail
+
+inline void add(Counter c, std::uint64_t n = 1) {
+    detail::Block* b = detail::local;
+    if (!b) [[unlikely]] b = &detail::registerThread();
+    // Only this thread writes the block, so no read-modify-write is needed.
+    auto& slot = b->counts[static_cast<size_t>(c)];
+    slot.store(slot.load(std::memory_order_relaxed) + n,
+               std::memory_order_relaxed);
+}
+
+}  // namespace itmoscript::stats
+
+#endif
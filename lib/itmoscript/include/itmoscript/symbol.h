@@ -0,0 +1,52 @@
+#ifndef ITMOSCRIPT_SYMBOL_H
+#define ITMOSCRIPT_SYMBOL_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "itmoscript/value.h"
+
+namespace itmoscript {
+
+/**
+ *  Interned string: identifiers and string literals of a program. Each
+ *  distinct string has a single entry in a process-wide table, created on
+ *  first use and kept for the life of the process, so a symbol is one
+ *  pointer that compares by address and carries its hash. The table is
+ *  safe to use from several threads.
+ */
+class Symbol {
+   public:
+    explicit Symbol(std::string_view name);
+
+    const std::string& str() const noexcept { return entry_->name; }
+    size_t hash() const noexcept { return entry_->hash; }
+    // The string as a value; every copy shares the same buffer.
+    const Value& value() const noexcept { return entry_->value; }
+
+    bool operator==(const Symbol& other) const noexcept {
+        return entry_ == other.entry_;
+    }
+
+   private:
+    struct Entry {
+        std::string name;
+        size_t hash;
+        Value value;
+    };
+
+    const Entry* entry_;
+};
+
+}  // namespace itmoscript
+
+template <>
+struct std::hash<itmoscript::Symbol> {
+    size_t operator()(const itmoscript::Symbol& s) const noexcept {
+        return s.hash();
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ITMOSCRIPT_THREAD_POOL_H
+#define ITMOSCRIPT_THREAD_POOL_H
+
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace itmoscript {
+
+/**
+ *  Fixed set of worker threads for data-parallel builtins. The thread that
+ *  calls run() takes part in the work, so a pool of size n starts n - 1
+ *  threads.
+ */
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t size);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const noexcept { return threads_.size() + 1; }
+
+    // Calls task(0) .. task(n - 1) across the pool and returns once all of
+    // them have finished. The first exception thrown by a task is rethrown.
+    void run(size_t n, const std::function<void(size_t)>& task);
+
+   private:
+    void workerLoop();
+
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+/**
+ *  Stable sort of items split into one run per thread: the runs are sorted
+ *  concurrently and then merged pairwise, a level at a time. The result is
+ *  the same as std::stable_sort with the same comparator.
+ */
+template <typename T, typename Compare>
+void parallelStableSort(std::vector<T>& items, Compare less,
+                        ThreadPool& pool) {
+    size_t runs = std::bit_ceil(pool.size());
+    size_t n = items.size();
+    if (runs < 2 || n < runs) {
+        std::stable_sort(items.begin(), items.end(), less);
+        return;
+    }
+
+    auto bound = [&](size_t i) { return i * n / runs; };
+    pool.run(runs, [&](size_t i) {
+        std::stable_sort(items.begin() + bound(i), items.begin() + bound(i + 1),
+                         less);
+    });
+
+    std::vector<T> merged(n);
+    for (size_t width = 1; width < runs; width *= 2) {
+        pool.run(runs / (2 * width), [&](size_t j) {
+            size_t lo = bound(2 * j * width);
+            size_t mid = bound((2 * j + 1) * width);
+            size_t hi = bound((2 * j + 2) * width);
+            std::merge(std::make_move_iterator(items.begin() + lo),
+                       std::make_move_iterator(items.begin() + mid),
+                       std::make_move_iterator(items.begin() + mid),
+                       std::make_move_iterator(items.begin() + hi),
+                       merged.begin() + lo, less);
+        });
+        items.swap(merged);
+    }
+}
+
+}  // namespace itmoscript
+
+#endif
@@ -31,6 +31,11 @@ enum class TokenType {
     LessEqual,
     Greater,
     GreaterEqual,
+    Ampersand,
+    Pipe,
+    Tilde,
+    ShiftLeft,
+    ShiftRight,
 
     LeftParen,
     RightParen,
@@ -53,6 +58,7 @@ enum class TokenType {
     And,
     Or,
     Not,
+    Xor,
 
     NewLine,
     EndOfFile,
@@ -0,0 +1,69 @@
+#ifndef ITMOSCRIPT_TRACER_H
+#define ITMOSCRIPT_TRACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "itmoscript/symbol.h"
+
+namespace itmoscript {
+
+/**
+ *  Records when script functions and builtins are entered and left, for
+ *  viewing as a timeline in Perfetto or chrome://tracing. Every thread
+ *  appends to a buffer of its own, so recording takes no locks; a thread
+ *  takes the lock once, to register its buffer. Calls shorter than the
+ *  minimum duration are dropped when they end, which keeps traces of long
+ *  runs small.
+ */
+class Tracer {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Tracer(std::chrono::nanoseconds minDuration = {});
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // A call of name starts or ends on the calling thread; calls nest.
+    void enter(Symbol name, bool builtin = false);
+    void exit();
+
+    // Calls recorded so far, over all threads.
+    size_t events() const;
+
+    // Writes the calls as Chrome trace-event JSON, one complete ("X")
+    // event per call. No thread may be recording meanwhile.
+    void writeJson(std::ostream& os) const;
+
+   private:
+    struct Event {
+        Symbol name;
+        bool builtin;
+        Clock::time_point start;
+        Clock::duration length;
+    };
+    struct Buffer {
+        std::uint32_t thread;
+        // Calls entered and not yet left; length is unset.
+        std::vector<Event> open;
+        std::vector<Event> done;
+    };
+
+    Buffer& local();
+
+    const std::uint64_t id_;
+    const Clock::duration minDuration_;
+    const Clock::time_point epoch_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+}  // namespace itmoscript
+
+#endif
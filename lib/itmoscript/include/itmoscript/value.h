@@ -2,52 +2,308 @@
 #ifndef ITMOSCRIPT_VALUE_H
 #define ITMOSCRIPT_VALUE_H
 
+#include <cstdint>
+#include <deque>
+#include <compare>
+#include <cstddef>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#include "itmoscript/persistent_vector.h"
+#include "itmoscript/stats.h"
+
 namespace itmoscript {
 
 class Environment;
+class Heap;
+class OrderedMap;
 
 class Value {
    public:
-    enum class Type { Number, String, Boolean, Nil, List, Function };
+    enum class Type {
+        Number,
+        String,
+        Boolean,
+        Nil,
+        List,
+        Function,
+        Heap,
+        Deque,
+        OrderedMap
+    };
 
     using ListType = std::vector<Value>;
-    using FuncType =
-        std::function<Value(const std::vector<Value>&, Environment&)>;
+    // Lists whose elements are all numbers are kept packed as plain doubles.
+    // Integers pack only while a double holds them exactly (|x| <= 2^53);
+    // whole values in that range come back out as integers, which print and
+    // compute the same as the doubles would.
+    using NumArray = std::vector<double>;
+    // Large lists that are updated while shared move to a persistent tree;
+    // see pushElement().
+    using PersistentList = PersistentVector<Value>;
+    class ListView;
+    using DequeType = std::deque<Value>;
+    // Arguments are owned by the call: a callee may consume (move from) them,
+    // but only once it can no longer fail, so that a failed call leaves them
+    // intact.
+    using FuncType = std::function<Value(std::vector<Value>&, Environment&)>;
 
    private:
+    // Strings and lists live in buffers shared by copies and slices of the
+    // same value, each seeing the window [off, off + len) of the buffer
+    // (len == npos: all of it). Writes go through mutableString() and
+    // mutableList(), which copy the window out first unless this value is
+    // the only owner of the buffer.
+    template <typename T>
+    struct Shared {
+        std::shared_ptr<T> buf;
+        size_t off = 0;
+        size_t len = std::string::npos;
+    };
+
+    template <typename T>
+    static T& unshare(Shared<T>& data);
+
     Type type_;
-    std::variant<std::monostate, double, std::string, bool, ListType, FuncType>
+    // Numbers are stored as int64_t while they are exact integers and as
+    // double otherwise; both are Type::Number. Copies of a function share
+    // its callable, so a function keeps its identity when it is passed on.
+    std::variant<std::monostate, double, Shared<std::string>, bool,
+                 Shared<ListType>, std::shared_ptr<const FuncType>,
+                 std::int64_t, Shared<NumArray>, PersistentList,
+                 std::shared_ptr<Heap>, std::shared_ptr<DequeType>,
+                 std::shared_ptr<OrderedMap>>
         data_;
 
+    // Switches a packed or persistent list to a flat one with one Value per
+    // element.
+    void flatten();
+    // Whether a non-destructive update of this list should go to a
+    // persistent tree; converts a large flat list that is shared.
+    bool updatesPersistently();
+
    public:
     static Value makeNumber(double x) { return Value(x); }
+    static Value makeInteger(std::int64_t x) { return Value(x); }
     static Value makeString(std::string s) { return Value(std::move(s)); }
     static Value makeBoolean(bool b) { return Value(b); }
     static Value makeNil() { return Value(); }
     static Value makeList(ListType v) { return Value(std::move(v)); }
+    static Value makeArray(NumArray v) { return Value(std::move(v)); }
     static Value makeFunction(FuncType f) { return Value(std::move(f)); }
+    static Value makeHeap(Heap h);
+    static Value makeDeque(DequeType d);
+    static Value makeOrderedMap(OrderedMap m);
 
     Type type() const noexcept { return type_; }
+    bool isInteger() const noexcept {
+        return std::holds_alternative<std::int64_t>(data_);
+    }
     double asNumber() const;
-    const std::string& asString() const;
+    // Integer value of a number; doubles are truncated toward zero.
+    std::int64_t asInteger() const;
+    std::string_view asString() const;
     bool asBoolean() const;
-    const ListType& asList() const;
+    ListView asList() const;
     const FuncType& asFunction() const;
+    const Heap& asHeap() const;
+    const DequeType& asDeque() const;
+    const OrderedMap& asOrderedMap() const;
+    bool isPacked() const noexcept {
+        return std::holds_alternative<Shared<NumArray>>(data_);
+    }
+    bool isPersistent() const noexcept {
+        return std::holds_alternative<PersistentList>(data_);
+    }
+
+    std::string& mutableString();
+    // Flattens a packed or persistent list first; the element updates below
+    // keep the representation instead.
+    ListType& mutableList();
+    NumArray& mutableNumbers();
+    // Copy the container first unless this value is its only owner.
+    Heap& mutableHeap();
+    DequeType& mutableDeque();
+    OrderedMap& mutableOrderedMap();
+
+    // Updates of the list held by this value. A list no other value holds is
+    // changed in place. A shared one is copied first unless it is long, in
+    // which case it becomes a persistent tree that later versions share
+    // instead of copying.
+    void pushElement(Value v);
+    void insertElement(size_t i, Value v);
+    void eraseElement(size_t i);
+    void setElement(size_t i, Value v);
+    void appendList(const Value& tail);
+
+    // Stores v into out when it is a number that packs without loss.
+    static bool packable(const Value& v, double& out) noexcept;
+    // The element a packed list holds as x.
+    static Value unpacked(double x) noexcept;
+
+    // Elements [start, end) of a string or list, sharing this value's buffer.
+    Value slice(size_t start, size_t end) const;
 
     std::string toString() const;
 
     Value() noexcept;
     explicit Value(double x);
-    explicit Value(const std::string& s);
+    explicit Value(std::int64_t x);
+    explicit Value(std::string s);
     explicit Value(bool b);
     explicit Value(ListType v);
+    explicit Value(NumArray v);
+    explicit Value(PersistentList v);
     explicit Value(FuncType f);
+
+    // Copies are counted in the stats; moves are free and not counted.
+    Value(const Value& other) : type_(other.type_), data_(other.data_) {
+        stats::add(stats::Counter::ValueCopies);
+    }
+    Value(Value&&) noexcept = default;
+    Value& operator=(const Value& other) {
+        type_ = other.type_;
+        data_ = other.data_;
+        stats::add(stats::Counter::ValueCopies);
+        return *this;
+    }
+    Value& operator=(Value&&) noexcept = default;
+    ~Value() = default;
+};
+
+// Three-way comparison of sort keys: numbers by value, strings
+// lexicographically. Throws unless both are numbers or both are strings.
+int compareKeys(const Value& a, const Value& b);
+
+/**
+ *  Read-only view of list elements, valid while the list is unchanged. Views
+ *  of packed and persistent lists produce their elements on access, so
+ *  elements are returned by value; numbers() and values() expose the
+ *  storage of flat lists directly. Iterators of a persistent list's view
+ *  must not outlive the view.
+ */
+class Value::ListView {
+   public:
+    class iterator {
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Value;
+
+        iterator() = default;
+        iterator(const Value* values, const double* numbers,
+                 const PersistentList* tree, size_t i)
+            : values_(values), numbers_(numbers), tree_(tree), i_(i) {}
+
+        Value operator*() const { return (*this)[0]; }
+        Value operator[](difference_type n) const {
+            size_t i = i_ + n;
+            if (numbers_) return Value::unpacked(numbers_[i]);
+            if (!tree_) return values_[i];
+            // Walks the tree once per leaf rather than once per element.
+            if (i - leafStart_ >= leaf_.size())
+                leaf_ = tree_->leafAt(i, leafStart_);
+            return leaf_[i - leafStart_];
+        }
+        iterator& operator++() { return ++i_, *this; }
+        iterator operator++(int) { return moved(i_++); }
+        iterator& operator--() { return --i_, *this; }
+        iterator operator--(int) { return moved(i_--); }
+        iterator& operator+=(difference_type n) { return i_ += n, *this; }
+        iterator& operator-=(difference_type n) { return i_ -= n, *this; }
+        iterator operator+(difference_type n) const { return moved(i_ + n); }
+        friend iterator operator+(difference_type n, const iterator& it) {
+            return it + n;
+        }
+        iterator operator-(difference_type n) const { return moved(i_ - n); }
+        difference_type operator-(const iterator& o) const {
+            return static_cast<difference_type>(i_) -
+                   static_cast<difference_type>(o.i_);
+        }
+        auto operator<=>(const iterator& o) const { return i_ <=> o.i_; }
+        bool operator==(const iterator& o) const { return i_ == o.i_; }
+
+       private:
+        iterator moved(size_t i) const {
+            return {values_, numbers_, tree_, i};
+        }
+
+        const Value* values_ = nullptr;
+        const double* numbers_ = nullptr;
+        const PersistentList* tree_ = nullptr;
+        size_t i_ = 0;
+        mutable std::span<const Value> leaf_;
+        mutable size_t leafStart_ = 0;
+    };
+
+    ListView() = default;
+    ListView(std::span<const Value> values)
+        : values_(values), size_(values.size()) {}
+    ListView(const ListType& values) : ListView(std::span(values)) {}
+    ListView(const Value* first, size_t count)
+        : ListView(std::span(first, count)) {}
+    explicit ListView(std::span<const double> numbers)
+        : numbers_(numbers), size_(numbers.size()), packed_(true) {}
+    explicit ListView(PersistentList tree)
+        : tree_(std::move(tree)), size_(tree_.size()), persistent_(true) {}
+
+    bool isPacked() const noexcept { return packed_; }
+    bool isPersistent() const noexcept { return persistent_; }
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    Value operator[](size_t i) const {
+        if (packed_) return Value::unpacked(numbers_[i]);
+        if (persistent_) return tree_[offset_ + i];
+        return values_[i];
+    }
+    Value front() const { return (*this)[0]; }
+    Value back() const { return (*this)[size() - 1]; }
+
+    // The storage of a packed / flat list; empty for the other kinds.
+    std::span<const double> numbers() const noexcept { return numbers_; }
+    std::span<const Value> values() const noexcept { return values_; }
+    // The elements of a persistent list's view as a tree of their own.
+    PersistentList tree() const {
+        if (offset_ == 0 && size_ == tree_.size()) return tree_;
+        return tree_.slice(offset_, offset_ + size_);
+    }
+
+    ListView subspan(size_t off, size_t count) const {
+        if (packed_) return ListView(numbers_.subspan(off, count));
+        if (!persistent_) return ListView(values_.subspan(off, count));
+        ListView out = *this;
+        out.offset_ += off;
+        out.size_ = count;
+        return out;
+    }
+    ListView first(size_t count) const { return subspan(0, count); }
+
+    iterator begin() const { return at(0); }
+    iterator end() const { return at(size_); }
+
+   private:
+    iterator at(size_t i) const {
+        if (packed_) return {nullptr, numbers_.data(), nullptr, i};
+        if (persistent_) return {nullptr, nullptr, &tree_, offset_ + i};
+        return {values_.data(), nullptr, nullptr, i};
+    }
+
+    std::span<const Value> values_;
+    std::span<const double> numbers_;
+    PersistentList tree_;
+    size_t offset_ = 0;
+    size_t size_ = 0;
+    bool packed_ = false;
+    bool persistent_ = false;
 };
 
 }  // namespace itmoscript
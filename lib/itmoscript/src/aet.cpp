@@ -2,12 +2,23 @@
 
 #include "itmoscript/aet.h"
 
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <stdexcept>
 #include <unordered_map>
+#include <utility>
 
 #include "itmoscript/ast.h"
 #include "itmoscript/environment.h"
+#include "itmoscript/heap.h"
+#include "itmoscript/numeric.h"
+#include "itmoscript/ordered_map.h"
+#include "itmoscript/symbol.h"
 
 namespace itmoscript {
 
@@ -30,15 +41,327 @@ bool isTruthy(const Value& v) {
     }
 }
 
+bool bothNumbers(const Value& a, const Value& b) {
+    return a.type() == Value::Type::Number && b.type() == Value::Type::Number;
+}
+
+// Exponentiation by squaring; false when the power does not fit.
+bool intPow(std::int64_t base, std::int64_t exp, std::int64_t& r) {
+    std::int64_t acc = 1;
+    while (exp > 0) {
+        if ((exp & 1) && mulOverflow(acc, base, acc)) return false;
+        exp >>= 1;
+        if (exp > 0 && mulOverflow(base, base, base)) return false;
+    }
+    r = acc;
+    return true;
+}
+
+/**
+ *  Arithmetic operators on numbers. Integer operands give an exact integer
+ *  result whenever it fits in int64; overflow, inexact division, division by
+ *  zero and negative powers fall back to double arithmetic.
+ */
+Value arithmetic(char op, const Value& a, const Value& b) {
+    if (a.isInteger() && b.isInteger()) {
+        std::int64_t x = a.asInteger(), y = b.asInteger(), r = 0;
+        bool exact = false;
+        switch (op) {
+            case '+':
+                exact = !addOverflow(x, y, r);
+                break;
+            case '-':
+                exact = !subOverflow(x, y, r);
+                break;
+            case '*':
+                exact = !mulOverflow(x, y, r);
+                break;
+            case '/':
+                if (y != 0 && y != -1 && x % y == 0) {
+                    r = x / y;
+                    exact = true;
+                } else if (y == -1) {
+                    exact = !subOverflow(0, x, r);
+                }
+                break;
+            case '%':
+                if (y != 0) {
+                    r = y == -1 ? 0 : x % y;
+                    exact = true;
+                }
+                break;
+            case '^':
+                exact = y >= 0 && intPow(x, y, r);
+                break;
+        }
+        if (exact) return Value::makeInteger(r);
+    }
+
+    double x = a.asNumber(), y = b.asNumber();
+    switch (op) {
+        case '+':
+            return Value::makeNumber(x + y);
+        case '-':
+            return Value::makeNumber(x - y);
+        case '*':
+            return Value::makeNumber(x * y);
+        case '/':
+            return Value::makeNumber(x / y);
+        case '%':
+            return Value::makeNumber(std::fmod(x, y));
+        case '^':
+            return Value::makeNumber(std::pow(x, y));
+    }
+    type_error(std::string("Unsupported op '") + op + "'");
+    return Value::makeNil();
+}
+
+// Operand of a bitwise operator: an integer, or a double with a whole value.
+std::int64_t bitOperand(const Value& v, const std::string& op) {
+    if (v.type() != Value::Type::Number ||
+        (!v.isInteger() && std::trunc(v.asNumber()) != v.asNumber()))
+        type_error(op + " requires integers");
+    return v.asInteger();
+}
+
+// Shifts on 64-bit two's complement; counts of 64 and more shift everything
+// out.
+std::int64_t shiftLeft(std::int64_t a, std::int64_t n) {
+    if (n < 0) type_error("negative shift count");
+    if (n >= 64) return 0;
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) << n);
+}
+
+std::int64_t shiftRight(std::int64_t a, std::int64_t n) {
+    if (n < 0) type_error("negative shift count");
+    if (n >= 64) return a < 0 ? -1 : 0;
+    return a >> n;
+}
+
+// Consumes a break or continue pending at the end of a loop body; returns
+// false when the loop has to stop, which includes a pending return.
+bool endIteration(Environment& env) {
+    env.step();
+    env.safepoint();
+    switch (env.unwinding()) {
+        case Environment::Unwind::None:
+            return true;
+        case Environment::Unwind::Continue:
+            env.endUnwind();
+            return true;
+        case Environment::Unwind::Break:
+            env.endUnwind();
+            return false;
+        case Environment::Unwind::Return:
+            return false;
+    }
+    return false;
+}
+
+// Element index for `seq[i]`; negative values count from the end.
+std::int64_t toIndex(const Value& v, size_t size) {
+    std::int64_t i = v.asInteger();
+    if (i < 0) i += static_cast<std::int64_t>(size);
+    if (i < 0 || i >= static_cast<std::int64_t>(size))
+        type_error("index out of bounds");
+    return i;
+}
+
+// `*` on strings and lists: the result is sized once up front.
+std::string repeatString(std::string_view s, std::int64_t times,
+                         const Environment& env) {
+    std::string out;
+    if (times <= 0) return out;
+    env.checkAllocation(s.size(), times);
+    out.reserve(s.size() * times);
+    while (times-- > 0) out += s;
+    return out;
+}
+
+template <typename T, typename Items>
+std::vector<T> repeated(const Items& items, std::int64_t times,
+                        const Environment& env) {
+    std::vector<T> out;
+    if (times <= 0) return out;
+    env.checkAllocation(items.size() * sizeof(T), times);
+    out.reserve(items.size() * times);
+    while (times-- > 0) out.insert(out.end(), items.begin(), items.end());
+    return out;
+}
+
+Value repeatList(Value::ListView lst, std::int64_t times,
+                 const Environment& env) {
+    if (lst.isPacked()) {
+        return Value::makeArray(repeated<double>(lst.numbers(), times, env));
+    }
+    return Value::makeList(repeated<Value>(lst, times, env));
+}
+
+// Python-style bounds of s[start:end] for a sequence of length n; nil means
+// the respective end of the sequence.
+std::pair<size_t, size_t> sliceBounds(const Value& startVal,
+                                      const Value& endVal, size_t size) {
+    auto n = static_cast<std::int64_t>(size);
+    std::int64_t start = 0, end = n;
+    if (startVal.type() == Value::Type::Number) {
+        start = startVal.asInteger();
+        if (start < 0) start += n;
+    }
+    if (endVal.type() == Value::Type::Number) {
+        end = endVal.asInteger();
+        if (end < 0) end += n;
+    }
+    start = std::clamp<std::int64_t>(start, 0, n);
+    end = std::clamp(end, start, n);
+    return {start, end};
+}
+
+bool isMovableOp(const std::string& op) {
+    return op == "+" || op == "-" || op == "*";
+}
+
+// Whether a builtin handed v may run script code with it: a function, or
+// a heap that calls its key function on push.
+bool runsScript(const Value& v) {
+    if (v.type() == Value::Type::Function) return true;
+    return v.type() == Value::Type::Heap &&
+           v.asHeap().keyFunction().type() == Value::Type::Function;
+}
+
+/**
+ *  Liveness for `name = rhs`: returns the path from rhs down to the read of
+ *  `name` that is the last use of its old value, or an empty path.
+ *
+ *  The read is delayed until everything else in rhs has been evaluated, so
+ *  it is only looked for where that reordering is unobservable: as a direct
+ *  argument of a call, or as the left operand of `+`, `-`, `*`. Only rhs
+ *  itself consumes the value, so when it fails the value can be put back;
+ *  an operator above it could fail after the value was changed in place.
+ */
+std::vector<const ASTNode*> lastUsePath(const ASTNode* e,
+                                        const std::string& name) {
+    auto isVar = [&](const ASTNode* n) {
+        return n->type == NodeType::Identifier && n->value == name;
+    };
+
+    if (e->type == NodeType::FunctionCall && e->children.size() > 1 &&
+        e->children[0]->type == NodeType::Identifier) {
+        const auto& args = e->children[1]->children;
+        for (auto it = args.rbegin(); it != args.rend(); ++it) {
+            if (isVar(it->get())) return {e, it->get()};
+        }
+        return {};
+    }
+
+    if (e->type == NodeType::BinaryOp && isMovableOp(e->value) &&
+        e->children.size() == 2 && isVar(e->children[0].get())) {
+        return {e, e->children[0].get()};
+    }
+
+    return {};
+}
+
+/**
+ *  A function definition; each execution makes a function value that
+ *  captures the variables of the frame it runs in.
+ */
+struct LambdaNode : AETNode {
+    std::string name;
+    Symbol label;
+    std::vector<Symbol> params;
+    AETNodePtr body;
+    // The syntax tree the node was built from, which snapshots save.
+    std::shared_ptr<const ASTNode> definition;
+
+    LambdaNode(std::string n, Symbol l, std::vector<Symbol> ps, AETNodePtr b,
+               std::shared_ptr<const ASTNode> d)
+        : name(std::move(n)),
+          label(l),
+          params(std::move(ps)),
+          body(std::move(b)),
+          definition(std::move(d)) {}
+
+    // Shared by every copy of the function value, so passing a function
+    // around copies one pointer rather than its captures.
+    struct Closure {
+        std::string name;
+        Symbol label;
+        std::vector<Symbol> params;
+        AETNode* body;
+        Environment::Frame captured;
+        const LambdaNode* origin;
+        // Keeps origin alive for functions rebuilt by functionFrom().
+        std::shared_ptr<const LambdaNode> owner;
+    };
+
+    // The callable of the function values; named so that imageOf() can
+    // find the closure behind a value.
+    struct Call {
+        std::shared_ptr<const Closure> closure;
+
+        Value operator()(std::vector<Value>& args, Environment& env) const {
+            const Closure& c = *closure;
+            if (args.size() > c.params.size()) {
+                throw std::runtime_error(
+                    "Argument count mismatch in function '" + c.name +
+                    "' (expected at most " + std::to_string(c.params.size()) +
+                    ", got " + std::to_string(args.size()) + ")");
+            }
+
+            env.pushStack(c.name.empty() ? "<anonymous>" : c.name, c.label);
+            const AETNode* caller = env.statement();
+            env.pushFrame();
+
+            for (auto const& kv : c.captured) {
+                env.set(kv.first, kv.second);
+            }
+            for (size_t i = 0; i < args.size(); ++i) {
+                env.set(c.params[i], std::move(args[i]));
+            }
+            for (size_t i = args.size(); i < c.params.size(); ++i) {
+                env.set(c.params[i], Value::makeNil());
+            }
+
+            c.body->execute(env);
+            // A break or continue outside a loop just ends the call.
+            Value ret = env.endUnwind();
+
+            env.popFrame();
+            env.popStack();
+            env.resumeStatement(caller);
+            return ret;
+        }
+    };
+
+    Value execute(Environment& env) override {
+        return Value::makeFunction(Call{std::make_shared<const Closure>(
+            Closure{name, label, params, body.get(), env.getLocals(), this,
+                    nullptr})});
+    }
+};
+
 class Builder {
-    const ASTNode* ast_;
+    // Function definitions hold on to the tree rather than a copy.
+    std::shared_ptr<const ASTNode> ast_;
+    std::vector<const ASTNode*> movePath_;
+    // Variable an anonymous function being built is assigned to; names the
+    // function in profiles.
+    std::string assignedTo_;
+    SourceMap* spans_;
 
    public:
-    explicit Builder(const ASTNode* root) : ast_(root) {}
-    AETNodePtr build() { return buildNode(ast_); }
+    Builder(std::shared_ptr<const ASTNode> root, SourceMap* spans)
+        : ast_(std::move(root)), spans_(spans) {}
+    AETNodePtr build() { return buildNode(ast_.get()); }
 
    private:
     AETNodePtr buildNode(const ASTNode* node) {
+        auto out = makeNode(node);
+        if (spans_ && node->span.line > 0) spans_->add(out.get(), node->span);
+        return out;
+    }
+
+    AETNodePtr makeNode(const ASTNode* node) {
         using NT = NodeType;
         switch (node->type) {
             case NT::Program:
@@ -89,7 +412,9 @@ class Builder {
             std::vector<AETNodePtr> stmts;
             Value execute(Environment& env) override {
                 for (auto& s : stmts) {
+                    env.enterStatement(s.get());
                     s->execute(env);
+                    if (env.unwinding() != Environment::Unwind::None) break;
                 }
                 return Value::makeNil();
             }
@@ -103,117 +428,113 @@ class Builder {
 
     AETNodePtr makeAssignment(const ASTNode* p) {
         struct A : AETNode {
-            std::string name, op;
+            Symbol name;
+            std::string op;
             AETNodePtr expr;
-            A(std::string n, std::string o, AETNodePtr e)
-                : name(std::move(n)), op(std::move(o)), expr(std::move(e)) {}
+            A(Symbol n, std::string o, AETNodePtr e)
+                : name(n), op(std::move(o)), expr(std::move(e)) {}
 
             Value execute(Environment& env) override {
                 auto v = expr->execute(env);
                 if (op != "=") {
-                    Value old = env.get(name);
+                    // The old value dies here, so strings and lists are
+                    // updated in their own buffer.
+                    Value old = env.take(name);
+                    try {
+                        v = combine(old, std::move(v), env);
+                    } catch (...) {
+                        // Operand types are checked before old is changed.
+                        env.untake(name, std::move(old));
+                        throw;
+                    }
+                }
+                env.set(name, std::move(v));
+                return Value::makeNil();
+            }
 
-                    if (op == "+=") {
-                        if (old.type() == Value::Type::Number &&
-                            v.type() == Value::Type::Number) {
-                            v = Value::makeNumber(old.asNumber() +
-                                                  v.asNumber());
-                        }
+            Value combine(Value& old, Value v, const Environment& env) const {
+                if (op == "+=") {
+                    if (bothNumbers(old, v)) {
+                        v = arithmetic('+', old, v);
+                    }
 
-                        else if (old.type() == Value::Type::String &&
-                                 v.type() == Value::Type::String) {
-                            v = Value::makeString(old.asString() +
-                                                  v.asString());
-                        }
+                    else if (old.type() == Value::Type::String &&
+                             v.type() == Value::Type::String) {
+                        old.mutableString() += v.asString();
+                        v = std::move(old);
+                    }
 
-                        else if (old.type() == Value::Type::List &&
-                                 v.type() == Value::Type::List) {
-                            auto out = old.asList();
-                            const auto& rhs = v.asList();
-                            out.insert(out.end(), rhs.begin(), rhs.end());
-                            v = Value::makeList(std::move(out));
-                        } else {
-                            type_error("'+=' unsupported types");
-                        }
+                    else if (old.type() == Value::Type::List &&
+                             v.type() == Value::Type::List) {
+                        old.appendList(v);
+                        v = std::move(old);
+                    } else {
+                        type_error("'+=' unsupported types");
                     }
+                }
 
-                    else if (op == "-=") {
-                        if (old.type() == Value::Type::Number &&
-                            v.type() == Value::Type::Number) {
-                            v = Value::makeNumber(old.asNumber() -
-                                                  v.asNumber());
-                        }
+                else if (op == "-=") {
+                    if (bothNumbers(old, v)) {
+                        v = arithmetic('-', old, v);
+                    }
 
-                        else if (old.type() == Value::Type::String &&
-                                 v.type() == Value::Type::String) {
-                            const auto& a = old.asString();
-                            const auto& b = v.asString();
-                            if (a.size() >= b.size() &&
-                                a.compare(a.size() - b.size(), b.size(), b) ==
-                                    0) {
-                                v = Value::makeString(
-                                    a.substr(0, a.size() - b.size()));
-                            } else {
-                                type_error("'-=' suffix not found");
-                            }
+                    else if (old.type() == Value::Type::String &&
+                             v.type() == Value::Type::String) {
+                        auto a = old.asString();
+                        auto b = v.asString();
+                        if (a.size() >= b.size() &&
+                            a.compare(a.size() - b.size(), b.size(), b) == 0) {
+                            v = old.slice(0, a.size() - b.size());
                         } else {
-                            type_error("'-=' unsupported types");
+                            type_error("'-=' suffix not found");
                         }
+                    } else {
+                        type_error("'-=' unsupported types");
                     }
+                }
 
-                    else if (op == "*=") {
-                        if (old.type() == Value::Type::Number &&
-                            v.type() == Value::Type::Number) {
-                            v = Value::makeNumber(old.asNumber() *
-                                                  v.asNumber());
-                        }
+                else if (op == "*=") {
+                    if (bothNumbers(old, v)) {
+                        v = arithmetic('*', old, v);
+                    }
 
-                        else if (old.type() == Value::Type::String &&
-                                 v.type() == Value::Type::Number) {
-                            std::string out;
-                            int times = static_cast<int>(v.asNumber());
-                            while (times-- > 0) out += old.asString();
-                            v = Value::makeString(std::move(out));
-                        }
+                    else if (old.type() == Value::Type::String &&
+                             v.type() == Value::Type::Number) {
+                        v = Value::makeString(
+                            repeatString(old.asString(), v.asInteger(), env));
+                    }
 
-                        else if (old.type() == Value::Type::List &&
-                                 v.type() == Value::Type::Number) {
-                            auto base = old.asList();
-                            std::vector<Value> out;
-                            int times = static_cast<int>(v.asNumber());
-                            while (times-- > 0)
-                                out.insert(out.end(), base.begin(), base.end());
-                            v = Value::makeList(std::move(out));
-                        } else {
-                            type_error("'*=' unsupported types");
-                        }
+                    else if (old.type() == Value::Type::List &&
+                             v.type() == Value::Type::Number) {
+                        v = repeatList(old.asList(), v.asInteger(), env);
+                    } else {
+                        type_error("'*=' unsupported types");
                     }
+                }
 
-                    else {
-                        if (old.type() != Value::Type::Number ||
-                            v.type() != Value::Type::Number) {
-                            type_error(op + " requires numbers");
-                        }
-                        double a = old.asNumber(), b = v.asNumber();
-                        if (op == "/=")
-                            v = Value::makeNumber(a / b);
-                        else if (op == "%=")
-                            v = Value::makeNumber(std::fmod(a, b));
-                        else if (op == "^=")
-                            v = Value::makeNumber(std::pow(a, b));
-                        else
-                            type_error("Unsupported op '" + op + "'");
+                else {
+                    if (!bothNumbers(old, v)) {
+                        type_error(op + " requires numbers");
                     }
+                    if (op == "/=" || op == "%=" || op == "^=")
+                        v = arithmetic(op[0], old, v);
+                    else
+                        type_error("Unsupported op '" + op + "'");
                 }
-                env.set(name, std::move(v));
-                return Value::makeNil();
+                return v;
             }
         };
 
         auto var = p->value;
         auto op = p->children[1]->value;
-        auto rhs = buildNode(p->children[2].get());
-        return std::make_unique<A>(var, op, std::move(rhs));
+        const ASTNode* rhsAst = p->children[2].get();
+        std::vector<const ASTNode*> path;
+        if (op == "=") path = lastUsePath(rhsAst, var);
+        auto saved = std::exchange(movePath_, std::move(path));
+        if (rhsAst->type == NodeType::FunctionDefinition) assignedTo_ = var;
+        auto rhs = buildNode(rhsAst);
+        movePath_ = std::move(saved);
+        return std::make_unique<A>(Symbol(var), op, std::move(rhs));
     }
 
     AETNodePtr makeFuncCall(const ASTNode* p) {
@@ -235,12 +556,70 @@ class Builder {
             }
         };
 
+        // Call whose argument `last` is the last use of `var`. Builtins
+        // get the value moved in so they can update it in place; script
+        // functions, and builtins handed a callback or a heap with a key
+        // function, may still read `var` by name, so they get a copy.
+        struct FCMove : AETNode {
+            AETNodePtr expr;
+            std::vector<AETNodePtr> args;
+            Symbol callee, var;
+            size_t last;
+            FCMove(AETNodePtr e, std::vector<AETNodePtr> a, Symbol c,
+                   Symbol v, size_t l)
+                : expr(std::move(e)),
+                  args(std::move(a)),
+                  callee(c),
+                  var(v),
+                  last(l) {}
+            Value execute(Environment& env) override {
+                auto fval = expr->execute(env);
+                if (fval.type() != Value::Type::Function)
+                    type_error("Not a function: " + fval.toString());
+                bool movable = env.isBuiltin(callee);
+                std::vector<Value> avals(args.size());
+                for (size_t i = 0; i < args.size(); ++i) {
+                    if (i == last) continue;
+                    avals[i] = args[i]->execute(env);
+                    if (runsScript(avals[i])) movable = false;
+                }
+                if (!movable) {
+                    avals[last] = args[last]->execute(env);
+                    return fval.asFunction()(avals, env);
+                }
+                avals[last] = env.take(var);
+                if (runsScript(avals[last])) {
+                    // Leaves var in place for the script code to read.
+                    env.untake(var, avals[last]);
+                    return fval.asFunction()(avals, env);
+                }
+                try {
+                    return fval.asFunction()(avals, env);
+                } catch (...) {
+                    // Builtins only consume an argument once they can no
+                    // longer fail, so var gets its value back.
+                    env.untake(var, std::move(avals[last]));
+                    throw;
+                }
+            }
+        };
+
         std::vector<AETNodePtr> args;
+        size_t last = 0;
+        bool onPath = std::find(movePath_.begin(), movePath_.end(), p) !=
+                      movePath_.end();
         if (p->children.size() > 1) {
             for (auto& c0 : p->children[1]->children) {
+                if (onPath && c0.get() == movePath_.back()) last = args.size();
                 args.push_back(buildNode(c0.get()));
             }
         }
+        if (onPath) {
+            return std::make_unique<FCMove>(
+                buildNode(p->children[0].get()), std::move(args),
+                Symbol(p->children[0]->value), Symbol(movePath_.back()->value),
+                last);
+        }
         return std::make_unique<FC>(buildNode(p->children[0].get()),
                                     std::move(args));
     }
@@ -250,8 +629,9 @@ class Builder {
             AETNodePtr expr;
             R(AETNodePtr e) : expr(std::move(e)) {}
             Value execute(Environment& env) override {
-                auto v = expr->execute(env);
-                throw ReturnException{v};
+                env.beginUnwind(Environment::Unwind::Return,
+                                expr->execute(env));
+                return Value::makeNil();
             }
         };
         return std::make_unique<R>(buildNode(p->children[0].get()));
@@ -259,14 +639,20 @@ class Builder {
 
     AETNodePtr makeBreak() {
         struct B : AETNode {
-            Value execute(Environment&) override { throw BreakException{}; }
+            Value execute(Environment& env) override {
+                env.beginUnwind(Environment::Unwind::Break);
+                return Value::makeNil();
+            }
         };
         return std::make_unique<B>();
     }
 
     AETNodePtr makeContinue() {
         struct C : AETNode {
-            Value execute(Environment&) override { throw ContinueException{}; }
+            Value execute(Environment& env) override {
+                env.beginUnwind(Environment::Unwind::Continue);
+                return Value::makeNil();
+            }
         };
         return std::make_unique<C>();
     }
@@ -312,14 +698,13 @@ class Builder {
             W(AETNodePtr c, AETNodePtr b)
                 : cond(std::move(c)), body(std::move(b)) {}
             Value execute(Environment& env) override {
-                while (isTruthy(cond->execute(env))) {
-                    try {
-                        body->execute(env);
-                    } catch (ContinueException&) {
-                        continue;
-                    } catch (BreakException&) {
-                        break;
-                    }
+                while (true) {
+                    if (!isTruthy(cond->execute(env))) break;
+                    body->execute(env);
+                    if (!endIteration(env)) break;
+                    // The next test of the condition is part of the loop
+                    // statement, which the enclosing list entered first.
+                    env.enterStatement(this);
                 }
                 return Value::makeNil();
             }
@@ -330,35 +715,36 @@ class Builder {
 
     AETNodePtr makeFor(const ASTNode* p) {
         struct F : AETNode {
-            std::string var;
+            Symbol var;
             AETNodePtr iterable, body;
-            F(std::string v, AETNodePtr it, AETNodePtr b)
-                : var(std::move(v)),
+            F(Symbol v, AETNodePtr it, AETNodePtr b)
+                : var(v),
                   iterable(std::move(it)),
                   body(std::move(b)) {}
             Value execute(Environment& env) override {
                 auto col = iterable->execute(env);
-                if (col.type() != Value::Type::List)
-                    type_error("For loop expects list");
-                const auto& lst = col.asList();
-                for (auto& elt : lst) {
-                    env.pushFrame();
-                    env.set(var, elt);
-                    try {
+                auto loop = [&](const auto& items) {
+                    for (Value elt : items) {
+                        env.pushFrame();
+                        env.set(var, std::move(elt));
                         body->execute(env);
-                    } catch (ContinueException&) {
-                        env.popFrame();
-                        continue;
-                    } catch (BreakException&) {
                         env.popFrame();
-                        break;
+                        if (!endIteration(env)) break;
                     }
-                    env.popFrame();
+                };
+                if (col.type() == Value::Type::List) {
+                    loop(col.asList());
+                } else if (col.type() == Value::Type::Deque) {
+                    loop(col.asDeque());
+                } else if (col.type() == Value::Type::OrderedMap) {
+                    loop(col.asOrderedMap().elements());
+                } else {
+                    type_error("For loop expects list");
                 }
                 return Value::makeNil();
             }
         };
-        auto varname = p->children[0]->value;
+        Symbol varname(p->children[0]->value);
         auto iter = buildNode(p->children[1].get());
         auto body = buildNode(p->children[2].get());
         return std::make_unique<F>(varname, std::move(iter), std::move(body));
@@ -366,13 +752,16 @@ class Builder {
 
     AETNodePtr makeLambda(const ASTNode* p) {
         std::string fnName = p->value;
+        std::string label = std::exchange(assignedTo_, {});
+        if (!fnName.empty()) label = fnName;
+        if (label.empty()) label = "<anonymous>";
 
-        std::vector<std::string> params;
+        std::vector<Symbol> params;
         size_t idx = 0;
         if (!p->children.empty() &&
             p->children[idx]->type == NodeType::ParameterList) {
             for (auto& c : p->children[idx]->children) {
-                params.push_back(c->value);
+                params.emplace_back(c->value);
             }
             ++idx;
         }
@@ -382,7 +771,11 @@ class Builder {
             Seq(std::vector<AETNodePtr> v) : parts(std::move(v)) {}
             Value execute(Environment& env) override {
                 for (auto& part : parts) {
+                    // The body is a statement list that enters its own
+                    // statements; only a trailing return is one here.
+                    if (&part != &parts.front()) env.enterStatement(part.get());
                     part->execute(env);
+                    if (env.unwinding() != Environment::Unwind::None) break;
                 }
                 return Value::makeNil();
             }
@@ -397,79 +790,20 @@ class Builder {
             parts.push_back(buildNode(p->children[idx + 1].get()));
         }
 
-        struct LambdaNode : AETNode {
-            std::string name;
-            std::vector<std::string> params;
-            AETNodePtr body;
-
-            LambdaNode(std::string n, std::vector<std::string> ps, AETNodePtr b)
-                : name(std::move(n)),
-                  params(std::move(ps)),
-                  body(std::move(b)) {}
-
-            Value execute(Environment& env) override {
-                auto const& locals = env.getLocals();
-                std::unordered_map<std::string, Value> capturedClosure = locals;
-
-                auto capturedName = name;
-                auto capturedParams = params;
-                AETNode* bodyPtr = body.get();
-
-                Value::FuncType fn =
-                    [capturedName, capturedParams, bodyPtr, capturedClosure](
-                        auto const& args, Environment& env2) -> Value {
-                    env2.pushStack(capturedName.empty() ? "<anonymous>"
-                                                        : capturedName);
-
-                    env2.pushFrame();
-
-                    for (auto const& kv : capturedClosure) {
-                        env2.set(kv.first, kv.second);
-                    }
-
-                    if (args.size() > capturedParams.size()) {
-                        env2.popFrame();
-                        env2.popStack();
-                        throw std::runtime_error(
-                            "Argument count mismatch in function '" +
-                            capturedName + "' (expected at most " +
-                            std::to_string(capturedParams.size()) + ", got " +
-                            std::to_string(args.size()) + ")");
-                    }
-                    for (size_t i = 0; i < args.size(); ++i) {
-                        env2.set(capturedParams[i], args[i]);
-                    }
-                    for (size_t i = args.size(); i < capturedParams.size();
-                         ++i) {
-                        env2.set(capturedParams[i], Value::makeNil());
-                    }
-
-                    try {
-                        bodyPtr->execute(env2);
-                    } catch (ReturnException& re) {
-                        Value ret = re.value;
-                        env2.popFrame();
-                        env2.popStack();
-                        return ret;
-                    }
-
-                    env2.popFrame();
-                    env2.popStack();
-                    return Value::makeNil();
-                };
-
-                return Value::makeFunction(std::move(fn));
-            }
-        };
-
         return std::make_unique<LambdaNode>(
-            fnName, std::move(params), std::make_unique<Seq>(std::move(parts)));
+            fnName, Symbol(label), std::move(params),
+            std::make_unique<Seq>(std::move(parts)),
+            std::shared_ptr<const ASTNode>(ast_, p));
     }
 
     AETNodePtr makeBinaryOp(const ASTNode* p) {
         struct BO : AETNode {
             std::string op;
             AETNodePtr lhs, rhs;
+            // Set when lhs holds a last use: it must be read after rhs.
+            bool rhsFirst = false;
+            // The variable lhs moves out of, when lhs is that last use.
+            std::optional<Symbol> taken;
             BO(std::string o, AETNodePtr l, AETNodePtr r)
                 : op(std::move(o)), lhs(std::move(l)), rhs(std::move(r)) {}
             Value execute(Environment& env) override {
@@ -494,95 +828,88 @@ class Builder {
                     return Value::makeBoolean(isTruthy(rhs->execute(env)));
                 }
 
-                auto L = lhs->execute(env);
-                auto R = rhs->execute(env);
+                Value L, R;
+                if (rhsFirst) {
+                    R = rhs->execute(env);
+                    L = lhs->execute(env);
+                } else {
+                    L = lhs->execute(env);
+                    R = rhs->execute(env);
+                }
+                if (!taken) return combine(L, R, env);
+                try {
+                    return combine(L, R, env);
+                } catch (...) {
+                    // Operand types are checked before L is changed.
+                    env.untake(*taken, std::move(L));
+                    throw;
+                }
+            }
 
+            Value combine(Value& L, const Value& R,
+                          const Environment& env) const {
                 if (op == "+") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number) {
-                        return Value::makeNumber(L.asNumber() + R.asNumber());
+                    if (bothNumbers(L, R)) {
+                        return arithmetic('+', L, R);
                     }
 
                     if (L.type() == Value::Type::String &&
                         R.type() == Value::Type::String) {
-                        return Value::makeString(L.asString() + R.asString());
+                        L.mutableString() += R.asString();
+                        return std::move(L);
                     }
 
                     if (L.type() == Value::Type::List &&
                         R.type() == Value::Type::List) {
-                        auto out = L.asList();
-                        const auto& rhs = R.asList();
-                        out.insert(out.end(), rhs.begin(), rhs.end());
-                        return Value::makeList(std::move(out));
+                        L.appendList(R);
+                        return std::move(L);
                     }
                     type_error("+ unsupported types");
                 }
                 if (op == "-") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number) {
-                        return Value::makeNumber(L.asNumber() - R.asNumber());
+                    if (bothNumbers(L, R)) {
+                        return arithmetic('-', L, R);
                     }
 
                     if (L.type() == Value::Type::String &&
                         R.type() == Value::Type::String) {
-                        const auto& a = L.asString();
-                        const auto& b = R.asString();
+                        auto a = L.asString();
+                        auto b = R.asString();
                         if (a.size() >= b.size() &&
                             a.compare(a.size() - b.size(), b.size(), b) == 0) {
-                            return Value::makeString(
-                                a.substr(0, a.size() - b.size()));
+                            return L.slice(0, a.size() - b.size());
                         }
                         type_error("- string suffix not found");
                     }
                     type_error("- unsupported types");
                 }
                 if (op == "*") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number) {
-                        return Value::makeNumber(L.asNumber() * R.asNumber());
+                    if (bothNumbers(L, R)) {
+                        return arithmetic('*', L, R);
                     }
 
                     if (L.type() == Value::Type::String &&
                         R.type() == Value::Type::Number) {
-                        std::string out;
-                        int times = static_cast<int>(R.asNumber());
-                        while (times-- > 0) {
-                            out += L.asString();
-                        }
-                        return Value::makeString(out);
+                        return Value::makeString(
+                            repeatString(L.asString(), R.asInteger(), env));
                     }
 
                     if (L.type() == Value::Type::List &&
                         R.type() == Value::Type::Number) {
-                        auto base = L.asList();
-                        std::vector<Value> out;
-                        int times = static_cast<int>(R.asNumber());
-                        while (times-- > 0) {
-                            out.insert(out.end(), base.begin(), base.end());
-                        }
-                        return Value::makeList(std::move(out));
+                        return repeatList(L.asList(), R.asInteger(), env);
                     }
                     type_error("* unsupported types");
                 }
                 if (op == "/") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number)
-                        return Value::makeNumber(L.asNumber() / R.asNumber());
+                    if (bothNumbers(L, R)) return arithmetic('/', L, R);
                     type_error("/ supports numbers only");
                 }
                 if (op == "%") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number)
-                        return Value::makeNumber(
-                            std::fmod(L.asNumber(), R.asNumber()));
+                    if (bothNumbers(L, R)) return arithmetic('%', L, R);
                     type_error("% supports numbers only");
                 }
                 if (op == "^") {
-                    if (L.type() == Value::Type::Number &&
-                        R.type() == Value::Type::Number) {
-                        return Value::makeNumber(
-                            std::pow(L.asNumber(), R.asNumber()));
-                    }
+                    if (bothNumbers(L, R)) return arithmetic('^', L, R);
                     type_error("^ supports numbers only");
                 }
                 if (op == "==" || op == "!=") {
@@ -590,84 +917,58 @@ class Builder {
                     return Value::makeBoolean(op == "==" ? eq : !eq);
                 }
                 if ((op == "<" || op == "<=" || op == ">" || op == ">=") &&
-                    L.type() == Value::Type::Number &&
-                    R.type() == Value::Type::Number) {
-                    double a = L.asNumber();
-                    double b = R.asNumber();
-                    bool res = (op == "<"    ? a < b
-                                : op == "<=" ? a <= b
-                                : op == ">"  ? a > b
-                                             : a >= b);
-                    return Value::makeBoolean(res);
+                    bothNumbers(L, R)) {
+                    auto cmp = [&](auto a, auto b) {
+                        return op == "<"    ? a < b
+                               : op == "<=" ? a <= b
+                               : op == ">"  ? a > b
+                                            : a >= b;
+                    };
+                    if (L.isInteger() && R.isInteger())
+                        return Value::makeBoolean(
+                            cmp(L.asInteger(), R.asInteger()));
+                    return Value::makeBoolean(
+                        cmp(L.asNumber(), R.asNumber()));
                 }
 
                 if (op == "index") {
                     if (L.type() == Value::Type::List) {
-                        const auto& lst = L.asList();
-                        int n = static_cast<int>(lst.size());
+                        auto lst = L.asList();
 
                         if (R.type() == Value::Type::Number) {
-                            int i = static_cast<int>(R.asNumber());
-                            if (i < 0) i += n;
-                            if (i < 0 || i >= n)
-                                type_error("index out of bounds");
-                            return lst[i];
+                            return lst[toIndex(R, lst.size())];
                         }
 
                         if (R.type() == Value::Type::List) {
-                            const auto& sp = R.asList();
+                            auto sp = R.asList();
                             if (sp.size() != 2)
                                 type_error("slice spec must have 2 elements");
-
-                            int start = 0, end = n;
-                            if (sp[0].type() == Value::Type::Number) {
-                                start = static_cast<int>(sp[0].asNumber());
-                                if (start < 0) start += n;
-                            }
-                            if (sp[1].type() == Value::Type::Number) {
-                                end = static_cast<int>(sp[1].asNumber());
-                                if (end < 0) end += n;
-                            }
-
-                            start = std::clamp(start, 0, n);
-                            end = std::clamp(end, 0, n);
-                            std::vector<Value> out;
-                            for (int i = start; i < end; ++i)
-                                out.push_back(lst[i]);
-                            return Value::makeList(std::move(out));
+                            auto [start, end] =
+                                sliceBounds(sp[0], sp[1], lst.size());
+                            return L.slice(start, end);
                         }
                     }
 
                     if (L.type() == Value::Type::String) {
-                        const auto& s = L.asString();
-                        int n = static_cast<int>(s.size());
+                        auto s = L.asString();
                         if (R.type() == Value::Type::Number) {
-                            int i = static_cast<int>(R.asNumber());
-                            if (i < 0) i += n;
-                            if (i < 0 || i >= n)
-                                type_error("index out of bounds");
-                            return Value::makeString(std::string(1, s[i]));
+                            return Value::makeString(
+                                std::string(1, s[toIndex(R, s.size())]));
                         }
                         if (R.type() == Value::Type::List) {
-                            const auto& sp = R.asList();
+                            auto sp = R.asList();
                             if (sp.size() != 2)
                                 type_error("slice spec must have 2 elements");
-                            int start = 0, end = n;
-                            if (sp[0].type() == Value::Type::Number) {
-                                start = static_cast<int>(sp[0].asNumber());
-                                if (start < 0) start += n;
-                            }
-                            if (sp[1].type() == Value::Type::Number) {
-                                end = static_cast<int>(sp[1].asNumber());
-                                if (end < 0) end += n;
-                            }
-                            start = std::clamp(start, 0, n);
-                            end = std::clamp(end, 0, n);
-                            if (end <= start) return Value::makeString("");
-                            return Value::makeString(
-                                s.substr(start, end - start));
+                            auto [start, end] =
+                                sliceBounds(sp[0], sp[1], s.size());
+                            return L.slice(start, end);
                         }
                     }
+                    if (L.type() == Value::Type::Deque &&
+                        R.type() == Value::Type::Number) {
+                        const auto& d = L.asDeque();
+                        return d[toIndex(R, d.size())];
+                    }
                     type_error("indexing/slicing requires list or string");
                 }
                 type_error("Unknown binary op " + op);
@@ -675,6 +976,81 @@ class Builder {
             }
         };
 
+        // seq[start:end] evaluates its bounds directly instead of going
+        // through a [start, end] spec list, and shares seq's buffer.
+        struct Slice : AETNode {
+            AETNodePtr seq, start, end;
+            Slice(AETNodePtr q, AETNodePtr s, AETNodePtr e)
+                : seq(std::move(q)), start(std::move(s)), end(std::move(e)) {}
+            Value execute(Environment& env) override {
+                Value target = seq->execute(env);
+                Value from = start->execute(env);
+                Value to = end->execute(env);
+                size_t n = 0;
+                if (target.type() == Value::Type::List) {
+                    n = target.asList().size();
+                } else if (target.type() == Value::Type::String) {
+                    n = target.asString().size();
+                } else {
+                    type_error("indexing/slicing requires list or string");
+                }
+                auto [first, last] = sliceBounds(from, to, n);
+                return target.slice(first, last);
+            }
+        };
+
+        // Bitwise operators only take integers, so they get their own node
+        // that dispatches on an opcode resolved at build time.
+        struct BitOp : AETNode {
+            enum class Kind { And, Or, Xor, Shl, Shr };
+            std::string op;
+            Kind kind;
+            AETNodePtr lhs, rhs;
+            BitOp(std::string o, Kind k, AETNodePtr l, AETNodePtr r)
+                : op(std::move(o)),
+                  kind(k),
+                  lhs(std::move(l)),
+                  rhs(std::move(r)) {}
+            Value execute(Environment& env) override {
+                std::int64_t a = bitOperand(lhs->execute(env), op);
+                std::int64_t b = bitOperand(rhs->execute(env), op);
+                switch (kind) {
+                    case Kind::And:
+                        return Value::makeInteger(a & b);
+                    case Kind::Or:
+                        return Value::makeInteger(a | b);
+                    case Kind::Xor:
+                        return Value::makeInteger(a ^ b);
+                    case Kind::Shl:
+                        return Value::makeInteger(shiftLeft(a, b));
+                    case Kind::Shr:
+                        return Value::makeInteger(shiftRight(a, b));
+                }
+                return Value::makeNil();
+            }
+        };
+
+        static const std::unordered_map<std::string, BitOp::Kind> bitOps = {
+            {"&", BitOp::Kind::And},   {"|", BitOp::Kind::Or},
+            {"xor", BitOp::Kind::Xor}, {"<<", BitOp::Kind::Shl},
+            {">>", BitOp::Kind::Shr}};
+        if (auto it = bitOps.find(p->value); it != bitOps.end()) {
+            return std::make_unique<BitOp>(p->value, it->second,
+                                           buildNode(p->children[0].get()),
+                                           buildNode(p->children[1].get()));
+        }
+
+        const ASTNode* rhsAst =
+            p->children.size() > 1 ? p->children[1].get() : nullptr;
+        if (p->value == "index" && rhsAst &&
+            rhsAst->type == NodeType::BinaryOp && rhsAst->value == ":" &&
+            rhsAst->children.size() == 2) {
+            return std::make_unique<Slice>(
+                buildNode(p->children[0].get()),
+                buildNode(rhsAst->children[0].get()),
+                buildNode(rhsAst->children[1].get()));
+        }
+
         AETNodePtr left = buildNode(p->children[0].get());
         AETNodePtr right;
         if (p->value == ":" && p->children.size() < 2) {
@@ -683,8 +1059,14 @@ class Builder {
         } else {
             right = buildNode(p->children[1].get());
         }
-        return std::make_unique<BO>(p->value, std::move(left),
-                                    std::move(right));
+        auto out =
+            std::make_unique<BO>(p->value, std::move(left), std::move(right));
+        out->rhsFirst = std::find(movePath_.begin(), movePath_.end(), p) !=
+                        movePath_.end();
+        if (out->rhsFirst && p->children[0].get() == movePath_.back()) {
+            out->taken = Symbol(movePath_.back()->value);
+        }
+        return out;
     }
 
     AETNodePtr makeUnaryOp(const ASTNode* p) {
@@ -697,11 +1079,17 @@ class Builder {
                 auto v = arg->execute(env);
                 if (op == "-") {
                     if (v.type() != Value::Type::Number) type_error("unary -");
+                    using lim = std::numeric_limits<std::int64_t>;
+                    if (v.isInteger() && v.asInteger() != lim::min())
+                        return Value::makeInteger(-v.asInteger());
                     return Value::makeNumber(-v.asNumber());
                 }
                 if (op == "not") {
                     return Value::makeBoolean(!isTruthy(v));
                 }
+                if (op == "~") {
+                    return Value::makeInteger(~bitOperand(v, op));
+                }
                 type_error("Unknown unary " + op);
                 return Value::makeNil();
             }
@@ -724,6 +1112,15 @@ class Builder {
         }
 
         {
+            // Integer literals stay exact; everything else goes through stod.
+            const char* first = p->value.data();
+            const char* last = first + p->value.size();
+            std::int64_t i = 0;
+            auto [ptr, ec] = std::from_chars(first, last, i);
+            if (first != last && ec == std::errc() && ptr == last) {
+                return std::make_unique<L>(Value::makeInteger(i));
+            }
+
             size_t idx = 0;
             try {
                 double d = std::stod(p->value, &idx);
@@ -733,16 +1130,26 @@ class Builder {
             } catch (...) {
             }
         }
-        return std::make_unique<L>(Value::makeString(p->value));
+        // Equal string literals share one interned buffer.
+        return std::make_unique<L>(Symbol(p->value).value());
     }
 
     AETNodePtr makeIdentifier(const ASTNode* p) {
         struct ID : AETNode {
-            std::string name;
-            ID(std::string n) : name(std::move(n)) {}
+            Symbol name;
+            ID(Symbol n) : name(n) {}
             Value execute(Environment& env) override { return env.get(name); }
         };
-        return std::make_unique<ID>(p->value);
+        struct LastUse : AETNode {
+            Symbol name;
+            LastUse(Symbol n) : name(n) {}
+            Value execute(Environment& env) override { return env.take(name); }
+        };
+        if (!movePath_.empty() && movePath_.back() == p &&
+            movePath_[movePath_.size() - 2]->type == NodeType::BinaryOp) {
+            return std::make_unique<LastUse>(Symbol(p->value));
+        }
+        return std::make_unique<ID>(Symbol(p->value));
     }
 
     AETNodePtr makeListLiteral(const ASTNode* p) {
@@ -767,6 +1174,42 @@ class Builder {
 
 }  // namespace
 
-AETNodePtr buildAET(const ASTNode* ast) { return Builder(ast).build(); }
+AETNodePtr buildAET(std::shared_ptr<const ASTNode> ast, SourceMap* spans) {
+    return Builder(std::move(ast), spans).build();
+}
+
+bool imageOf(const Value& fn, FunctionImage& image) {
+    const auto* call = fn.asFunction().target<LambdaNode::Call>();
+    if (!call) return false;
+    const auto& c = *call->closure;
+    image.id = &c;
+    image.definition = c.origin->definition;
+    image.label = c.label.str();
+    image.captured.assign(c.captured.begin(), c.captured.end());
+    return true;
+}
+
+std::shared_ptr<const AETNode> buildFunction(
+    std::shared_ptr<const ASTNode> definition, const std::string& label) {
+    if (definition->type != NodeType::FunctionDefinition) {
+        throw std::runtime_error("not a function definition");
+    }
+    AETNodePtr built = buildAET(std::move(definition));
+    auto* node = static_cast<LambdaNode*>(built.release());
+    node->label = Symbol(label);
+    return std::shared_ptr<const LambdaNode>(node);
+}
+
+Value functionFrom(const std::shared_ptr<const AETNode>& function,
+                   std::vector<std::pair<Symbol, Value>> captured) {
+    auto node = std::static_pointer_cast<const LambdaNode>(function);
+    Environment::Frame frame;
+    for (auto& [name, value] : captured) frame.emplace(name, std::move(value));
+    return Value::makeFunction(
+        LambdaNode::Call{std::make_shared<const LambdaNode::Closure>(
+            LambdaNode::Closure{node->name, node->label, node->params,
+                                node->body.get(), std::move(frame),
+                                node.get(), node})});
+}
 
 }  // namespace itmoscript
@@ -1,10 +1,38 @@
 #include "itmoscript/environment.h"
 
+#include <algorithm>
 #include <stdexcept>
+#include <utility>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 namespace itmoscript {
 
-Value Environment::get(const std::string& name) const {
+namespace {
+
+// Operations between checks of the clock and the heap.
+constexpr std::int64_t kCheckInterval = 1 << 14;
+// Smaller allocations are left to the checks made between operations.
+constexpr std::uint64_t kLargeAllocation = 1 << 16;
+
+// Bytes in use on the heap of the process. Without mallinfo2() the sizes
+// of the value buffers created so far stand in for it.
+size_t heapInUse() {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    auto bytes = stats::read()[static_cast<size_t>(
+        stats::Counter::BufferBytes)];
+    return static_cast<size_t>(bytes);
+#endif
+}
+
+}  // namespace
+
+Value Environment::get(Symbol name) const {
     for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
         auto found = it->find(name);
         if (found != it->end()) {
@@ -16,17 +44,208 @@ Value Environment::get(const std::string& name) const {
     if (g != globals_.end()) {
         return g->second;
     }
-    throw std::runtime_error("Undefined variable '" + name + "'");
+    throw std::runtime_error("Undefined variable '" + name.str() + "'");
 }
 
-void Environment::set(const std::string& name, Value val) {
+void Environment::set(Symbol name, Value val) {
     frames_.back()[name] = std::move(val);
 }
 
-void Environment::pushFrame() { frames_.emplace_back(); }
+Value Environment::take(Symbol name) {
+    auto& top = frames_.back();
+    auto found = top.find(name);
+    if (found == top.end()) {
+        return get(name);
+    }
+    return std::exchange(found->second, Value());
+}
+
+void Environment::untake(Symbol name, Value value) {
+    auto& top = frames_.back();
+    auto found = top.find(name);
+    if (found != top.end()) {
+        found->second = std::move(value);
+    }
+}
+
+bool Environment::isBuiltin(Symbol name) const {
+    for (const auto& frame : frames_) {
+        if (frame.count(name)) {
+            return false;
+        }
+    }
+    return globals_.count(name) != 0;
+}
+
+std::unique_ptr<Environment> Environment::fork() const {
+    auto env = std::make_unique<Environment>();
+    env->globals_ = globals_;
+    env->frames_.emplace_back();
+    auto& base = env->frames_.back();
+    for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+        base.insert(it->begin(), it->end());
+    }
+    env->callStack_ = callStack_;
+    env->tracer_ = tracer_;
+    if (limits_.any()) {
+        env->limits_ = limits_;
+        env->parentSpent_ = &forkSpent_;
+        env->parentBase_ = spent_ + (granted_ - fuel_);
+        env->spent_ = env->parentBase_ + forkSpent_.load();
+        env->maxDepth_ = maxDepth_;
+        env->deadline_ = deadline_;
+        env->heapBase_ = heapBase_;
+        env->grant();
+    }
+    return env;
+}
+
+void Environment::joinForks() {
+    if (!limits_.any()) return;
+    spent_ += static_cast<std::uint64_t>(granted_ - fuel_) +
+              forkSpent_.exchange(0);
+    granted_ = fuel_ = 0;
+    checkLimits();
+    grant();
+}
+
+Environment::~Environment() {
+    // The operations since the last grant, which no refuel has charged.
+    if (parentSpent_) {
+        parentSpent_->fetch_add(static_cast<std::uint64_t>(granted_ - fuel_));
+    }
+}
+
+void Environment::applyLimits(const Limits& limits) {
+    limits_ = limits;
+    if (limits.callDepth) maxDepth_ = limits.callDepth;
+    deadline_ = std::chrono::steady_clock::now() + limits.wallTime;
+    heapBase_ = heapInUse();
+    spent_ = 0;
+    grant();
+}
+
+void Environment::grant() {
+    std::int64_t n = std::numeric_limits<std::int64_t>::max();
+    // Forks check often enough to see what the others have spent.
+    if (limits_.wallTime.count() || limits_.heapBytes || parentSpent_) {
+        n = kCheckInterval;
+    }
+    if (limits_.operations) {
+        auto left = limits_.operations - std::min(spent_, limits_.operations);
+        n = static_cast<std::int64_t>(
+            std::min<std::uint64_t>(static_cast<std::uint64_t>(n), left));
+    }
+    granted_ = fuel_ = n;
+}
+
+void Environment::refuel() {
+    // The grant is used up and this operation takes one more.
+    charge(static_cast<std::uint64_t>(granted_) + 1);
+    granted_ = fuel_ = 0;
+    checkLimits();
+    grant();
+}
+
+void Environment::charge(std::uint64_t n) {
+    if (parentSpent_) {
+        spent_ = parentBase_ + parentSpent_->fetch_add(n) + n;
+    } else {
+        spent_ += n;
+    }
+}
+
+void Environment::checkLimits() const {
+    if (limits_.operations && spent_ > limits_.operations) {
+        throw LimitExceeded(LimitExceeded::Kind::Operations,
+                            "Operation limit of " +
+                                std::to_string(limits_.operations) +
+                                " exceeded");
+    }
+    if (limits_.wallTime.count() &&
+        std::chrono::steady_clock::now() > deadline_) {
+        throw LimitExceeded(LimitExceeded::Kind::WallTime,
+                            "Time limit of " +
+                                std::to_string(limits_.wallTime.count()) +
+                                " ms exceeded");
+    }
+    if (limits_.heapBytes && heapInUse() > heapBase_ + limits_.heapBytes) {
+        outOfHeap();
+    }
+}
+
+void Environment::checkAllocation(std::uint64_t count,
+                                  std::uint64_t size) const {
+    if (!limits_.heapBytes) return;
+    std::uint64_t bytes =
+        size && count > std::numeric_limits<std::uint64_t>::max() / size
+            ? std::numeric_limits<std::uint64_t>::max()
+            : count * size;
+    if (bytes < kLargeAllocation) return;
+    if (bytes > limits_.heapBytes ||
+        heapInUse() + bytes > heapBase_ + limits_.heapBytes) {
+        outOfHeap();
+    }
+}
+
+void Environment::tooDeep() const {
+    throw LimitExceeded(LimitExceeded::Kind::CallDepth,
+                        "Call depth limit of " + std::to_string(maxDepth_) +
+                            " exceeded");
+}
+
+void Environment::outOfHeap() const {
+    throw LimitExceeded(LimitExceeded::Kind::HeapBytes,
+                        "Memory limit of " +
+                            std::to_string(limits_.heapBytes) +
+                            " bytes exceeded");
+}
+
+void Environment::Builder::traceBuiltins() {
+    for (auto& [name, value] : globals_) {
+        if (value.type() != Value::Type::Function) continue;
+        value = Value::makeFunction(
+            [tracer = tracer_, name = name, fn = value.asFunction()](
+                auto& args, Environment& env) -> Value {
+                // Ends the event when the builtin throws, too.
+                struct Scope {
+                    Tracer* tracer;
+                    ~Scope() { tracer->exit(); }
+                };
+                tracer->enter(name, true);
+                Scope scope{tracer};
+                return fn(args, env);
+            });
+    }
+}
+
+ThreadPool* Environment::pool() {
+    if (workers_ <= 1) return nullptr;
+    if (!pool_) pool_ = std::make_unique<ThreadPool>(workers_);
+    return pool_.get();
+}
+
+void Environment::pushFrame() {
+    stats::add(stats::Counter::FramePushes);
+    if (spareFrames_.empty()) {
+        frames_.emplace_back();
+        return;
+    }
+    frames_.push_back(std::move(spareFrames_.back()));
+    spareFrames_.pop_back();
+}
+
+void Environment::resetToTopLevel() {
+    while (frames_.size() > 1) popFrame();
+    while (!callStack_.empty()) popStack();
+    endUnwind();
+    statement_ = nullptr;
+}
 
 void Environment::popFrame() {
     if (frames_.size() > 1) {
+        frames_.back().clear();
+        spareFrames_.push_back(std::move(frames_.back()));
         frames_.pop_back();
     }
 }
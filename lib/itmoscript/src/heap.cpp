@@ -0,0 +1,57 @@
+#include "itmoscript/heap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace itmoscript {
+
+bool Heap::after(const Entry& a, const Entry& b) {
+    int c = compareKeys(a.key, b.key);
+    if (c != 0) return c > 0;
+    return a.seq > b.seq;
+}
+
+void Heap::push(Value item, Value key) {
+    auto kind = key.type();
+    if (kind != Value::Type::Number && kind != Value::Type::String) {
+        throw std::runtime_error("heap keys must be numbers or strings");
+    }
+    if (!entries_.empty() && entries_.front().key.type() != kind) {
+        throw std::runtime_error(
+            "heap keys must be all numbers or all strings");
+    }
+    entries_.push_back({std::move(key), std::move(item), nextSeq_++});
+    std::push_heap(entries_.begin(), entries_.end(), after);
+}
+
+void Heap::pop() {
+    std::pop_heap(entries_.begin(), entries_.end(), after);
+    entries_.pop_back();
+}
+
+std::vector<Heap::Entry> Heap::sorted() const {
+    auto sorted = entries_;
+    std::sort_heap(sorted.begin(), sorted.end(), after);
+    std::reverse(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+std::vector<Value> Heap::ordered() const {
+    std::vector<Value> out;
+    out.reserve(entries_.size());
+    for (auto& e : sorted()) out.push_back(std::move(e.item));
+    return out;
+}
+
+std::vector<std::pair<Value, Value>> Heap::keyed() const {
+    std::vector<std::pair<Value, Value>> out;
+    out.reserve(entries_.size());
+    for (auto& e : sorted()) {
+        out.emplace_back(std::move(e.key), std::move(e.item));
+    }
+    return out;
+}
+
+}  // namespace itmoscript
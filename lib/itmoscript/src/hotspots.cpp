@@ -0,0 +1,86 @@
+#include "itmoscript/hotspots.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "itmoscript/aet.h"
+
+namespace itmoscript {
+
+namespace {
+
+// Line number (1-based) of source, without its indentation.
+std::string lineText(std::string_view source, int number) {
+    size_t begin = 0;
+    for (int i = 1; i < number && begin != std::string_view::npos; ++i) {
+        begin = source.find('\n', begin);
+        if (begin != std::string_view::npos) ++begin;
+    }
+    if (begin == std::string_view::npos) return {};
+    size_t end = std::min(source.find('\n', begin), source.size());
+    std::string_view line = source.substr(begin, end - begin);
+    size_t first = line.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return {};
+    return std::string(line.substr(first));
+}
+
+}  // namespace
+
+void Hotspots::attribute(const SourceMap& sources, std::string_view source,
+                         int firstLine) {
+    if (current_) switchTo(nullptr);
+    for (const auto& [node, counts] : nodes_) {
+        const SourceSpan* span = sources.find(node);
+        Line& line = lines_[span ? span->line : 0];
+        line.counts.count += counts.count;
+        line.counts.time += counts.time;
+    }
+    nodes_.clear();
+
+    int lastLine = firstLine + static_cast<int>(std::count(
+                                   source.begin(), source.end(), '\n'));
+    for (auto it = lines_.lower_bound(std::max(firstLine, 1));
+         it != lines_.end() && it->first <= lastLine; ++it) {
+        if (it->second.text.empty()) {
+            it->second.text = lineText(source, it->first - firstLine + 1);
+        }
+    }
+}
+
+void Hotspots::writeReport(std::ostream& os) const {
+    std::vector<std::pair<int, const Line*>> rows;
+    Clock::duration all{};
+    for (const auto& [number, line] : lines_) {
+        rows.emplace_back(number, &line);
+        all += line.counts.time;
+    }
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const auto& a, const auto& b) {
+                         const Counts& x = a.second->counts;
+                         const Counts& y = b.second->counts;
+                         return x.time != y.time ? x.time > y.time
+                                                 : x.count > y.count;
+                     });
+
+    os << "       count          ms   time%  line\n";
+    for (const auto& [number, line] : rows) {
+        double ms = std::chrono::duration<double, std::milli>(
+                        line->counts.time)
+                        .count();
+        double share = all.count() > 0 ? 100.0 * line->counts.time / all : 0;
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "%12llu %11.3f %6.2f%% ",
+                      static_cast<unsigned long long>(line->counts.count), ms,
+                      share);
+        os << buf;
+        if (number > 0) {
+            std::snprintf(buf, sizeof buf, "%5d: ", number);
+            os << buf << line->text << "\n";
+        } else {
+            os << "    ?\n";
+        }
+    }
+}
+
+}  // namespace itmoscript
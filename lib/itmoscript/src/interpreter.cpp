@@ -1,16 +1,26 @@
 #include "itmoscript/interpreter.h"
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "itmoscript/aet.h"
 #include "itmoscript/environment.h"
+#include "itmoscript/hotspots.h"
 #include "itmoscript/lexer.h"
 #include "itmoscript/parser.h"
+#include "itmoscript/profiler.h"
+#include "itmoscript/snapshot.h"
+#include "itmoscript/statement_reader.h"
 #include "itmoscript/stdlib.h"
+#include "itmoscript/tracer.h"
 #include "itmoscript/value.h"
 
 namespace itmoscript {
@@ -29,6 +39,183 @@ bool interpret(std::istream& codeIn, std::ostream& out) {
  */
 bool interpret(std::istream& codeIn, std::istream& runtimeIn,
                std::ostream& out) {
+    return interpret(codeIn, runtimeIn, out, InterpreterOptions{});
+}
+
+namespace {
+
+std::unique_ptr<Environment> makeEnvironment(std::istream& runtimeIn,
+                                             std::ostream& out,
+                                             const InterpreterOptions& options,
+                                             const SourceMap& sources) {
+    Environment::Builder eb;
+    size_t workers = options.workers;
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    eb.setInput(runtimeIn).setOutput(out).setWorkers(workers);
+    eb.setSourceMap(sources);
+    if (options.profiler) eb.setProfiler(*options.profiler);
+    if (options.hotspots) eb.setHotspots(*options.hotspots);
+    if (options.tracer) eb.setTracer(*options.tracer);
+    eb.setLimits(options.limits);
+
+    registerStandardLibrary(eb);
+
+    auto env = eb.build();
+    if (!options.restoreSnapshot.empty()) {
+        snapshot::load(options.restoreSnapshot, *env);
+    }
+    return env;
+}
+
+// Reports an error raised by the statement env was executing.
+void report(const std::runtime_error& e, const Environment& env) {
+    std::cerr << e.what();
+    if (const SourceSpan* at = env.location()) {
+        std::cerr << " at line " << at->line << ", column " << at->column;
+    }
+    std::cerr << std::endl;
+}
+
+// Whether the tree built from ast creates functions, which point into it.
+bool definesFunction(const ASTNode* ast) {
+    if (ast->type == NodeType::FunctionDefinition) return true;
+    return std::any_of(ast->children.begin(), ast->children.end(),
+                       [](const auto& c) { return definesFunction(c.get()); });
+}
+
+}  // namespace
+
+struct Session::State {
+    // A copy: sessions are often made from a temporary.
+    InterpreterOptions options;
+    SourceMap sources;
+    std::unique_ptr<Environment> env;
+    // Trees of statements that define functions, which point into them;
+    // all others are destroyed after they ran.
+    std::vector<AETNodePtr> kept;
+    // Text of the kept trees, whose lines the hotspot report may need.
+    std::vector<std::pair<std::string, int>> keptText;
+
+    explicit State(const InterpreterOptions& options) : options(options) {}
+
+    // Folds the hotspot counts of the statements just run into lines.
+    void attribute(const StatementReader& reader) {
+        if (!options.hotspots) return;
+        options.hotspots->attribute(sources, reader.text(),
+                                    reader.firstLine());
+    }
+};
+
+Session::Session(std::istream& runtimeIn, std::ostream& out,
+                 const InterpreterOptions& options)
+    : state_(std::make_unique<State>(options)) {
+    state_->env = makeEnvironment(runtimeIn, out, options, state_->sources);
+    if (options.profiler) options.profiler->start();
+}
+
+Session::~Session() {
+    const InterpreterOptions& options = state_->options;
+    if (options.profiler) options.profiler->stop();
+    if (!options.hotspots) return;
+    // Functions kept from earlier statements may have run since.
+    for (const auto& [text, first] : state_->keptText) {
+        options.hotspots->attribute(state_->sources, text, first);
+    }
+}
+
+bool Session::run(StatementReader& reader) {
+    State& s = *state_;
+    Environment& env = *s.env;
+    while (true) {
+        std::shared_ptr<const ASTNode> ast;
+        try {
+            ast = reader.next();
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+        if (!ast) return true;
+
+        size_t mark = s.sources.mark();
+        auto root = buildAET(ast, &s.sources);
+        bool keep = definesFunction(ast.get());
+        ast.reset();
+        bool failed = false;
+        // Rethrown once the session is ready for more input.
+        std::exception_ptr breach;
+        try {
+            root->execute(env);
+        } catch (const LimitExceeded&) {
+            breach = std::current_exception();
+        } catch (const std::runtime_error& e) {
+            report(e, env);
+            failed = true;
+        }
+
+        s.attribute(reader);
+        if (keep) {
+            s.kept.push_back(std::move(root));
+            if (s.options.hotspots) {
+                s.keptText.emplace_back(reader.text(), reader.firstLine());
+            }
+        } else {
+            s.sources.rollback(mark);
+        }
+        if (breach) {
+            env.resetToTopLevel();
+            env.renewLimits();
+            std::rethrow_exception(breach);
+        }
+        if (failed) {
+            env.resetToTopLevel();
+            return false;
+        }
+        // A return or break at the top level ends the program.
+        if (env.unwinding() != Environment::Unwind::None) {
+            env.endUnwind();
+            return true;
+        }
+        // Whoever reads the output sees each statement's at once.
+        env.out().flush();
+    }
+}
+
+bool Session::run(std::istream& code) {
+    StatementReader reader(code);
+    return run(reader);
+}
+
+void Session::save(const std::string& path) const {
+    snapshot::save(*state_->env, path);
+}
+
+namespace {
+
+// Executes each top-level statement as soon as it is complete.
+bool interpretStreaming(std::istream& codeIn, std::istream& runtimeIn,
+                        std::ostream& out, const InterpreterOptions& options) {
+    try {
+        Session session(runtimeIn, out, options);
+        if (!session.run(codeIn)) return false;
+        if (!options.saveSnapshot.empty()) session.save(options.saveSnapshot);
+        return true;
+    } catch (const LimitExceeded&) {
+        throw;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+}
+
+}  // namespace
+
+bool interpret(std::istream& codeIn, std::istream& runtimeIn,
+               std::ostream& out, const InterpreterOptions& options) {
+    if (options.streaming) {
+        return interpretStreaming(codeIn, runtimeIn, out, options);
+    }
     try {
         std::string src((std::istreambuf_iterator<char>(codeIn)),
                         std::istreambuf_iterator<char>());
@@ -39,17 +226,35 @@ bool interpret(std::istream& codeIn, std::istream& runtimeIn,
         Parser parser(tokens);
         auto ast = parser.parseProgram();
 
-        auto root = buildAET(ast.get());
-
-        Environment::Builder eb;
-        eb.setInput(runtimeIn).setOutput(out);
-
-        registerStandardLibrary(eb);
+        SourceMap sources;
+        auto root = buildAET(std::move(ast), &sources);
 
-        auto env = eb.build();
+        auto env = makeEnvironment(runtimeIn, out, options, sources);
 
-        root->execute(*env);
+        // Stops the instruments; the counters must be read while the tree
+        // is alive.
+        auto finish = [&] {
+            if (options.profiler) options.profiler->stop();
+            if (options.hotspots) options.hotspots->attribute(sources, src);
+        };
+        if (options.profiler) options.profiler->start();
+        try {
+            root->execute(*env);
+        } catch (const LimitExceeded&) {
+            finish();
+            throw;
+        } catch (const std::runtime_error& e) {
+            finish();
+            report(e, *env);
+            return false;
+        }
+        finish();
+        if (!options.saveSnapshot.empty()) {
+            snapshot::save(*env, options.saveSnapshot);
+        }
         return true;
+    } catch (const LimitExceeded&) {
+        throw;
     } catch (std::runtime_error e) {
         std::cerr << e.what() << std::endl;
         return false;
@@ -23,11 +23,13 @@ static const std::unordered_map<std::string, TokenType> keywords = {
     {"and", TokenType::And},
     {"or", TokenType::Or},
     {"not", TokenType::Not},
+    {"xor", TokenType::Xor},
     {"true", TokenType::Boolean},
     {"false", TokenType::Boolean},
     {"nil", TokenType::Nil}};
 
-Lexer::Lexer(const std::string& source) noexcept : source_(source) {}
+Lexer::Lexer(const std::string& source, int firstLine) noexcept
+    : source_(source), line_(firstLine) {}
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
@@ -95,11 +97,23 @@ std::vector<Token> Lexer::tokenize() {
                         match('=') ? TokenType::NotEqual : TokenType::Unknown;
                     break;
                 case '<':
-                    type = match('=') ? TokenType::LessEqual : TokenType::Less;
+                    type = match('<')   ? TokenType::ShiftLeft
+                           : match('=') ? TokenType::LessEqual
+                                        : TokenType::Less;
                     break;
                 case '>':
-                    type = match('=') ? TokenType::GreaterEqual
-                                      : TokenType::Greater;
+                    type = match('>')   ? TokenType::ShiftRight
+                           : match('=') ? TokenType::GreaterEqual
+                                        : TokenType::Greater;
+                    break;
+                case '&':
+                    type = TokenType::Ampersand;
+                    break;
+                case '|':
+                    type = TokenType::Pipe;
+                    break;
+                case '~':
+                    type = TokenType::Tilde;
                     break;
                 case '(':
                     type = TokenType::LeftParen;
@@ -134,7 +148,8 @@ std::vector<Token> Lexer::tokenize() {
                  type == TokenType::CaretEqual ||
                  type == TokenType::EqualEqual || type == TokenType::NotEqual ||
                  type == TokenType::LessEqual ||
-                 type == TokenType::GreaterEqual)
+                 type == TokenType::GreaterEqual ||
+                 type == TokenType::ShiftLeft || type == TokenType::ShiftRight)
                     ? 2
                     : 1;
             lexeme = source_.substr(pos_ - length, length);
@@ -0,0 +1,190 @@
+#include "itmoscript/numeric.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ITMOSCRIPT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace itmoscript::kernels {
+
+namespace {
+
+// Portable loops. Four accumulators keep the reductions free of a single
+// dependency chain, which also lets the compiler vectorize them with SSE2.
+
+double sumScalar(const double* x, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i];
+        s1 += x[i + 1];
+        s2 += x[i + 2];
+        s3 += x[i + 3];
+    }
+    for (; i < n; ++i) s0 += x[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+double dotScalar(const double* a, const double* b, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <bool Max>
+size_t argBestScalar(const double* x, size_t n) {
+    size_t best = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (Max ? x[i] > x[best] : x[i] < x[best]) best = i;
+    }
+    return best;
+}
+
+#ifdef ITMOSCRIPT_X86_KERNELS
+
+bool hasAvx2() {
+    static const bool yes =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return yes;
+}
+
+__attribute__((target("avx2"))) double horizontalSum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    __m128d pair = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+__attribute__((target("avx2"))) double sumAvx2(const double* x, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(x + i + 4));
+    }
+    double s = horizontalSum(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i) s += x[i];
+    return s;
+}
+
+__attribute__((target("avx2,fma"))) double dotAvx2(const double* a,
+                                                   const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                               acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4),
+                               _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    double s = horizontalSum(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i) s += a[i] * b[i];
+    return s;
+}
+
+// Finds the extreme value four lanes at a time and then its first position
+// with a second, cheap scan. NaNs break the lane-wise min/max, so when the
+// value is not found again the scalar loop decides.
+template <bool Max>
+__attribute__((target("avx2"))) size_t argBestAvx2(const double* x,
+                                                   size_t n) {
+    if (n < 8) return argBestScalar<Max>(x, n);
+    __m256d best = _mm256_loadu_pd(x);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        best = Max ? _mm256_max_pd(best, v) : _mm256_min_pd(best, v);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, best);
+    double value = lanes[0];
+    for (int k = 1; k < 4; ++k) {
+        if (Max ? lanes[k] > value : lanes[k] < value) value = lanes[k];
+    }
+    for (; i < n; ++i) {
+        if (Max ? x[i] > value : x[i] < value) value = x[i];
+    }
+    for (size_t j = 0; j < n; ++j) {
+        if (x[j] == value) return j;
+    }
+    return argBestScalar<Max>(x, n);
+}
+
+template <bool Mul>
+__attribute__((target("avx2"))) void elementwiseAvx2(const double* a,
+                                                     const double* b,
+                                                     double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        __m256d y = _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(out + i,
+                         Mul ? _mm256_mul_pd(x, y) : _mm256_add_pd(x, y));
+    }
+    for (; i < n; ++i) out[i] = Mul ? a[i] * b[i] : a[i] + b[i];
+}
+
+#endif
+
+}  // namespace
+
+double sum(std::span<const double> xs) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) return sumAvx2(xs.data(), xs.size());
+#endif
+    return sumScalar(xs.data(), xs.size());
+}
+
+double dot(std::span<const double> a, std::span<const double> b) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) return dotAvx2(a.data(), b.data(), a.size());
+#endif
+    return dotScalar(a.data(), b.data(), a.size());
+}
+
+size_t argmin(std::span<const double> xs) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) return argBestAvx2<false>(xs.data(), xs.size());
+#endif
+    return argBestScalar<false>(xs.data(), xs.size());
+}
+
+size_t argmax(std::span<const double> xs) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) return argBestAvx2<true>(xs.data(), xs.size());
+#endif
+    return argBestScalar<true>(xs.data(), xs.size());
+}
+
+void add(std::span<const double> a, std::span<const double> b,
+         std::span<double> out) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) {
+        elementwiseAvx2<false>(a.data(), b.data(), out.data(), out.size());
+        return;
+    }
+#endif
+    for (size_t i = 0; i < out.size(); ++i) out[i] = a[i] + b[i];
+}
+
+void mul(std::span<const double> a, std::span<const double> b,
+         std::span<double> out) {
+#ifdef ITMOSCRIPT_X86_KERNELS
+    if (hasAvx2()) {
+        elementwiseAvx2<true>(a.data(), b.data(), out.data(), out.size());
+        return;
+    }
+#endif
+    for (size_t i = 0; i < out.size(); ++i) out[i] = a[i] * b[i];
+}
+
+}  // namespace itmoscript::kernels
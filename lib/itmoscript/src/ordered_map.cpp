@@ -0,0 +1,245 @@
+#include "itmoscript/ordered_map.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace itmoscript {
+
+namespace {
+
+// Most entries per leaf and children per inner node. A node that drops
+// below a quarter of that is merged with a neighbour.
+constexpr size_t kMaxWidth = 64;
+constexpr size_t kMinWidth = kMaxWidth / 4;
+
+bool keyLess(const Value& a, const Value& b) { return compareKeys(a, b) < 0; }
+
+// The first entry of a sorted run whose key is not less than key.
+template <typename Entries>
+auto lowerBound(Entries& entries, const Value& key) {
+    return std::lower_bound(entries.begin(), entries.end(), key,
+                            [](const OrderedMap::Entry& e, const Value& k) {
+                                return keyLess(e.key, k);
+                            });
+}
+
+}  // namespace
+
+// Leaves hold entries; inner nodes hold kids, with keys[i] separating
+// kids[i] from kids[i + 1]: every key below kids[i] is less than it and
+// every key below kids[i + 1] is not. size counts the entries below.
+// Copies of a map share nodes; whatever changes a node first makes it
+// its own with own().
+struct OrderedMap::Node {
+    std::vector<Entry> entries;
+    std::vector<std::shared_ptr<Node>> kids;
+    std::vector<Value> keys;
+    size_t size = 0;
+
+    bool leaf() const noexcept { return kids.empty(); }
+    size_t width() const noexcept {
+        return leaf() ? entries.size() : kids.size();
+    }
+
+    // The child whose range holds key.
+    size_t childFor(const Value& key) const {
+        return std::upper_bound(keys.begin(), keys.end(), key, keyLess) -
+               keys.begin();
+    }
+
+    // n, copied first if another pointer holds it too. Trees are changed
+    // from the root down, so a node held once under parents that are as
+    // well belongs to no other tree.
+    static Node& own(std::shared_ptr<Node>& n) {
+        if (n.use_count() != 1) n = std::make_shared<Node>(*n);
+        return *n;
+    }
+
+    void collect(const OrderedMap& m, std::vector<Value>& out) const {
+        for (const auto& e : entries) out.push_back(m.element(e));
+        for (const auto& kid : kids) kid->collect(m, out);
+    }
+
+    // Moves the upper half of this node into a new right sibling and
+    // returns it with the key that separates the two.
+    std::pair<Value, std::shared_ptr<Node>> split() {
+        auto right = std::make_shared<Node>();
+        size_t mid = width() / 2;
+        Value sep;
+        if (leaf()) {
+            right->entries.assign(
+                std::make_move_iterator(entries.begin() + mid),
+                std::make_move_iterator(entries.end()));
+            entries.resize(mid);
+            right->size = right->entries.size();
+            sep = right->entries.front().key;
+        } else {
+            right->kids.assign(std::make_move_iterator(kids.begin() + mid),
+                               std::make_move_iterator(kids.end()));
+            right->keys.assign(keys.begin() + mid, keys.end());
+            sep = std::move(keys[mid - 1]);
+            kids.resize(mid);
+            keys.resize(mid - 1);
+            for (const auto& kid : right->kids) right->size += kid->size;
+        }
+        size -= right->size;
+        return {std::move(sep), std::move(right)};
+    }
+
+    // Appends the contents of right, separated from this node by sep.
+    void absorb(Node& right, Value sep) {
+        if (leaf()) {
+            entries.insert(entries.end(),
+                           std::make_move_iterator(right.entries.begin()),
+                           std::make_move_iterator(right.entries.end()));
+        } else {
+            keys.push_back(std::move(sep));
+            keys.insert(keys.end(), right.keys.begin(), right.keys.end());
+            kids.insert(kids.end(), std::make_move_iterator(right.kids.begin()),
+                        std::make_move_iterator(right.kids.end()));
+        }
+        size += right.size;
+    }
+
+    // Adds or replaces an entry below this node. Returns the new right
+    // sibling, with its separator, when the node overflowed.
+    std::pair<Value, std::shared_ptr<Node>> insert(Entry e, bool& added) {
+        if (leaf()) {
+            auto it = lowerBound(entries, e.key);
+            if (it != entries.end() && compareKeys(it->key, e.key) == 0) {
+                it->value = std::move(e.value);
+                added = false;
+                return {};
+            }
+            entries.insert(it, std::move(e));
+            added = true;
+        } else {
+            size_t i = childFor(e.key);
+            auto [sep, right] = own(kids[i]).insert(std::move(e), added);
+            if (right) {
+                keys.insert(keys.begin() + i, std::move(sep));
+                kids.insert(kids.begin() + i + 1, std::move(right));
+            }
+        }
+        if (added) ++size;
+        if (width() > kMaxWidth) return split();
+        return {};
+    }
+
+    bool erase(const Value& key) {
+        if (leaf()) {
+            auto it = lowerBound(entries, key);
+            if (it == entries.end() || compareKeys(it->key, key) != 0) {
+                return false;
+            }
+            entries.erase(it);
+            --size;
+            return true;
+        }
+        size_t i = childFor(key);
+        if (!own(kids[i]).erase(key)) return false;
+        --size;
+        if (kids[i]->width() < kMinWidth && kids.size() > 1) rebalance(i);
+        return true;
+    }
+
+    // Merges the small child i with a neighbour, splitting the result
+    // again when it is too wide, which evens out the two.
+    void rebalance(size_t i) {
+        size_t l = i > 0 ? i - 1 : i;
+        Node& left = own(kids[l]);
+        left.absorb(own(kids[l + 1]), std::move(keys[l]));
+        kids.erase(kids.begin() + l + 1);
+        keys.erase(keys.begin() + l);
+        if (left.width() > kMaxWidth) {
+            auto [sep, right] = left.split();
+            keys.insert(keys.begin() + l, std::move(sep));
+            kids.insert(kids.begin() + l + 1, std::move(right));
+        }
+    }
+};
+
+OrderedMap::OrderedMap(bool isSet)
+    : root_(std::make_shared<Node>()), isSet_(isSet) {}
+
+OrderedMap::OrderedMap(const OrderedMap& other)
+    : root_(other.root_), isSet_(other.isSet_) {}
+
+OrderedMap::OrderedMap(OrderedMap&&) noexcept = default;
+
+OrderedMap::~OrderedMap() = default;
+
+size_t OrderedMap::size() const noexcept { return root_->size; }
+
+bool OrderedMap::insert(Value key, Value value) {
+    auto kind = key.type();
+    if (kind != Value::Type::Number && kind != Value::Type::String) {
+        throw std::runtime_error("ordered keys must be numbers or strings");
+    }
+    bool added = false;
+    auto [sep, right] =
+        Node::own(root_).insert({std::move(key), std::move(value)}, added);
+    if (right) {
+        auto top = std::make_shared<Node>();
+        top->size = root_->size + right->size;
+        top->keys.push_back(std::move(sep));
+        top->kids.push_back(std::move(root_));
+        top->kids.push_back(std::move(right));
+        root_ = std::move(top);
+    }
+    return added;
+}
+
+bool OrderedMap::erase(const Value& key) {
+    if (!Node::own(root_).erase(key)) return false;
+    if (!root_->leaf() && root_->kids.size() == 1) {
+        root_ = std::move(root_->kids[0]);
+    }
+    return true;
+}
+
+const OrderedMap::Entry* OrderedMap::find(const Value& key) const {
+    const Node* n = root_.get();
+    while (!n->leaf()) n = n->kids[n->childFor(key)].get();
+    auto it = lowerBound(n->entries, key);
+    if (it == n->entries.end() || compareKeys(it->key, key) != 0) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+size_t OrderedMap::rank(const Value& key) const {
+    const Node* n = root_.get();
+    size_t below = 0;
+    while (!n->leaf()) {
+        size_t i = n->childFor(key);
+        for (size_t k = 0; k < i; ++k) below += n->kids[k]->size;
+        n = n->kids[i].get();
+    }
+    return below + (lowerBound(n->entries, key) - n->entries.begin());
+}
+
+const OrderedMap::Entry& OrderedMap::at(size_t i) const {
+    const Node* n = root_.get();
+    while (!n->leaf()) {
+        size_t k = 0;
+        while (i >= n->kids[k]->size) i -= n->kids[k++]->size;
+        n = n->kids[k].get();
+    }
+    return n->entries[i];
+}
+
+Value OrderedMap::element(const Entry& e) const {
+    if (isSet_) return e.key;
+    return Value::makeList({e.key, e.value});
+}
+
+std::vector<Value> OrderedMap::elements() const {
+    std::vector<Value> out;
+    out.reserve(size());
+    root_->collect(*this, out);
+    return out;
+}
+
+}  // namespace itmoscript
@@ -33,9 +33,27 @@ void Parser::expect(TokenType type, const std::string& message) {
     }
 }
 
+ASTNodePtr Parser::finish(ASTNodePtr n, size_t first) const {
+    size_t last = index_ > first ? index_ - 1 : first;
+    while (last > first && tokens_[last].type == TokenType::NewLine) --last;
+    const Token& a = tokens_[first];
+    const Token& b = tokens_[last];
+    n->span = {a.line, a.column, b.line,
+               b.column + static_cast<int>(b.lexeme.size())};
+    return n;
+}
+
+ASTNodePtr Parser::leaf(NodeType type, const Token& tok) {
+    auto n = std::make_unique<ASTNode>(type, tok.lexeme);
+    n->span = {tok.line, tok.column, tok.line,
+               tok.column + static_cast<int>(tok.lexeme.size())};
+    return n;
+}
+
 ASTNodePtr Parser::parseProgram() {
     auto node = std::make_unique<ASTNode>(NodeType::Program);
     node->addChild(parseStatementList());
+    node->span = node->children[0]->span;
     expect(TokenType::EndOfFile, "Expected end of file");
     return node;
 }
@@ -45,6 +63,7 @@ ASTNodePtr Parser::parseStatementList() {
 
     while (match(TokenType::NewLine)) {
     }
+    size_t first = index_;
 
     while (!check(TokenType::End) && !check(TokenType::Else) &&
            !check(TokenType::EndOfFile)) {
@@ -64,14 +83,15 @@ ASTNodePtr Parser::parseStatementList() {
         }
     }
 
-    return list;
+    return finish(std::move(list), first);
 }
 
 ASTNodePtr Parser::parseStatement() {
+    size_t first = index_;
     if (check(TokenType::If) || check(TokenType::While) ||
         check(TokenType::For))
-        return parseCompoundStatement();
-    return parseSimpleStatement();
+        return finish(parseCompoundStatement(), first);
+    return finish(parseSimpleStatement(), first);
 }
 
 ASTNodePtr Parser::parseSimpleStatement() {
@@ -106,42 +126,48 @@ ASTNodePtr Parser::parseCompoundStatement() {
 }
 
 ASTNodePtr Parser::parseAssignment() {
+    size_t first = index_;
     auto t = get();
     auto n = std::make_unique<ASTNode>(NodeType::Assignment, t.lexeme);
     auto o = get();
-    n->addChild(std::make_unique<ASTNode>(NodeType::Identifier, t.lexeme));
-    n->addChild(std::make_unique<ASTNode>(NodeType::Identifier, o.lexeme));
+    n->addChild(leaf(NodeType::Identifier, t));
+    n->addChild(leaf(NodeType::Identifier, o));
     n->addChild(parseExpression());
-    return n;
+    return finish(std::move(n), first);
 }
 
 ASTNodePtr Parser::parseFunctionCall() {
+    size_t first = index_;
     auto id = get();
     auto node = std::make_unique<ASTNode>(NodeType::FunctionCall, id.lexeme);
-    node->addChild(std::make_unique<ASTNode>(NodeType::Identifier, id.lexeme));
+    node->addChild(leaf(NodeType::Identifier, id));
     expect(TokenType::LeftParen, "Expected '('");
     if (!check(TokenType::RightParen)) node->addChild(parseArgumentList());
     expect(TokenType::RightParen, "Expected ')'");
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseReturn() {
+    size_t first = index_;
     get();
     auto node = std::make_unique<ASTNode>(NodeType::Return);
     node->addChild(parseExpression());
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseBreak() {
+    size_t first = index_;
     get();
-    return std::make_unique<ASTNode>(NodeType::Break);
+    return finish(std::make_unique<ASTNode>(NodeType::Break), first);
 }
 ASTNodePtr Parser::parseContinue() {
+    size_t first = index_;
     get();
-    return std::make_unique<ASTNode>(NodeType::Continue);
+    return finish(std::make_unique<ASTNode>(NodeType::Continue), first);
 }
 
 ASTNodePtr Parser::parseIf() {
+    size_t first = index_;
     get();
     auto node = std::make_unique<ASTNode>(NodeType::If);
     node->addChild(parseExpression());
@@ -150,50 +176,55 @@ ASTNodePtr Parser::parseIf() {
 
     while (check(TokenType::Else) && index_ + 1 < tokens_.size() &&
            tokens_[index_ + 1].type == TokenType::If) {
+        size_t branch = index_;
         get();
         get();
         auto elseif = std::make_unique<ASTNode>(NodeType::ElseIf);
         elseif->addChild(parseExpression());
         expect(TokenType::Then, "Expected 'then'");
         elseif->addChild(parseStatementList());
-        node->addChild(std::move(elseif));
+        node->addChild(finish(std::move(elseif), branch));
     }
 
+    size_t branch = index_;
     if (match(TokenType::Else)) {
         auto elseNode = std::make_unique<ASTNode>(NodeType::Else);
         elseNode->addChild(parseStatementList());
-        node->addChild(std::move(elseNode));
+        node->addChild(finish(std::move(elseNode), branch));
     }
 
     expect(TokenType::End, "Expected 'end'");
     expect(TokenType::If, "Expected 'if'");
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseWhile() {
+    size_t first = index_;
     get();
     auto node = std::make_unique<ASTNode>(NodeType::While);
     node->addChild(parseExpression());
     node->addChild(parseStatementList());
     expect(TokenType::End, "Expected 'end'");
     expect(TokenType::While, "Expected 'while'");
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseFor() {
+    size_t first = index_;
     get();
     auto node = std::make_unique<ASTNode>(NodeType::For);
     auto id = get();
-    node->addChild(std::make_unique<ASTNode>(NodeType::Identifier, id.lexeme));
+    node->addChild(leaf(NodeType::Identifier, id));
     expect(TokenType::In, "Expected 'in'");
     node->addChild(parseExpression());
     node->addChild(parseStatementList());
     expect(TokenType::End, "Expected 'end'");
     expect(TokenType::For, "Expected 'for'");
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseFunctionDefinition() {
+    size_t first = index_;
     auto name = get();
     expect(TokenType::Equals, "Expected '='");
     expect(TokenType::Function, "Expected 'function'");
@@ -206,44 +237,48 @@ ASTNodePtr Parser::parseFunctionDefinition() {
     if (check(TokenType::Return)) node->addChild(parseReturn());
     expect(TokenType::End, "Expected 'end'");
     expect(TokenType::Function, "Expected 'function'");
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseExpression() { return parseLogicalOr(); }
 
 ASTNodePtr Parser::parseLogicalOr() {
+    size_t first = index_;
     auto node = parseLogicalAnd();
     while (match(TokenType::Or)) {
         auto op = std::make_unique<ASTNode>(NodeType::BinaryOp, "or");
         op->addChild(std::move(node));
         op->addChild(parseLogicalAnd());
-        node = std::move(op);
+        node = finish(std::move(op), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseLogicalAnd() {
+    size_t first = index_;
     auto node = parseLogicalNot();
     while (match(TokenType::And)) {
         auto op = std::make_unique<ASTNode>(NodeType::BinaryOp, "and");
         op->addChild(std::move(node));
         op->addChild(parseLogicalNot());
-        node = std::move(op);
+        node = finish(std::move(op), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseLogicalNot() {
+    size_t first = index_;
     if (match(TokenType::Not)) {
         auto op = std::make_unique<ASTNode>(NodeType::UnaryOp, "not");
         op->addChild(parseLogicalNot());
-        return op;
+        return finish(std::move(op), first);
     }
     return parseComparison();
 }
 
 ASTNodePtr Parser::parseComparison() {
-    auto node = parseAdditive();
+    size_t first = index_;
+    auto node = parseBitOr();
     if (check(TokenType::EqualEqual) || check(TokenType::NotEqual) ||
         check(TokenType::Less) || check(TokenType::LessEqual) ||
         check(TokenType::Greater) || check(TokenType::GreaterEqual)) {
@@ -251,13 +286,64 @@ ASTNodePtr Parser::parseComparison() {
         std::string op = opToken.lexeme;
         auto opNode = std::make_unique<ASTNode>(NodeType::BinaryOp, op);
         opNode->addChild(std::move(node));
+        opNode->addChild(parseBitOr());
+        node = finish(std::move(opNode), first);
+    }
+    return node;
+}
+
+ASTNodePtr Parser::parseBitOr() {
+    size_t first = index_;
+    auto node = parseBitXor();
+    while (match(TokenType::Pipe)) {
+        auto opNode = std::make_unique<ASTNode>(NodeType::BinaryOp, "|");
+        opNode->addChild(std::move(node));
+        opNode->addChild(parseBitXor());
+        node = finish(std::move(opNode), first);
+    }
+    return node;
+}
+
+ASTNodePtr Parser::parseBitXor() {
+    size_t first = index_;
+    auto node = parseBitAnd();
+    while (match(TokenType::Xor)) {
+        auto opNode = std::make_unique<ASTNode>(NodeType::BinaryOp, "xor");
+        opNode->addChild(std::move(node));
+        opNode->addChild(parseBitAnd());
+        node = finish(std::move(opNode), first);
+    }
+    return node;
+}
+
+ASTNodePtr Parser::parseBitAnd() {
+    size_t first = index_;
+    auto node = parseShift();
+    while (match(TokenType::Ampersand)) {
+        auto opNode = std::make_unique<ASTNode>(NodeType::BinaryOp, "&");
+        opNode->addChild(std::move(node));
+        opNode->addChild(parseShift());
+        node = finish(std::move(opNode), first);
+    }
+    return node;
+}
+
+ASTNodePtr Parser::parseShift() {
+    size_t first = index_;
+    auto node = parseAdditive();
+    while (match(TokenType::ShiftLeft) || match(TokenType::ShiftRight)) {
+        auto opToken = tokens_[index_ - 1];
+        auto opNode =
+            std::make_unique<ASTNode>(NodeType::BinaryOp, opToken.lexeme);
+        opNode->addChild(std::move(node));
         opNode->addChild(parseAdditive());
-        node = std::move(opNode);
+        node = finish(std::move(opNode), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseAdditive() {
+    size_t first = index_;
     auto node = parseMultiplicative();
     while (match(TokenType::Plus) || match(TokenType::Minus)) {
         auto opToken = tokens_[index_ - 1];
@@ -265,12 +351,13 @@ ASTNodePtr Parser::parseAdditive() {
             std::make_unique<ASTNode>(NodeType::BinaryOp, opToken.lexeme);
         opNode->addChild(std::move(node));
         opNode->addChild(parseMultiplicative());
-        node = std::move(opNode);
+        node = finish(std::move(opNode), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseMultiplicative() {
+    size_t first = index_;
     auto node = parseExponent();
     while (match(TokenType::Star) || match(TokenType::Slash) ||
            match(TokenType::Percent)) {
@@ -279,34 +366,37 @@ ASTNodePtr Parser::parseMultiplicative() {
             std::make_unique<ASTNode>(NodeType::BinaryOp, opToken.lexeme);
         opNode->addChild(std::move(node));
         opNode->addChild(parseExponent());
-        node = std::move(opNode);
+        node = finish(std::move(opNode), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseExponent() {
+    size_t first = index_;
     auto node = parseUnary();
     while (match(TokenType::Caret)) {
         auto opNode = std::make_unique<ASTNode>(NodeType::BinaryOp, "^");
         opNode->addChild(std::move(node));
         opNode->addChild(parseUnary());
-        node = std::move(opNode);
+        node = finish(std::move(opNode), first);
     }
     return node;
 }
 
 ASTNodePtr Parser::parseUnary() {
-    if (match(TokenType::Plus) || match(TokenType::Minus)) {
+    size_t first = index_;
+    if (match(TokenType::Plus) || match(TokenType::Minus) ||
+        match(TokenType::Tilde)) {
         auto opToken = tokens_[index_ - 1];
         auto opNode =
             std::make_unique<ASTNode>(NodeType::UnaryOp, opToken.lexeme);
         opNode->addChild(parseUnary());
-        return opNode;
+        return finish(std::move(opNode), first);
     }
     return parsePrimary();
 }
 
-ASTNodePtr Parser::parsePostfix(ASTNodePtr lhs) {
+ASTNodePtr Parser::parsePostfix(ASTNodePtr lhs, size_t first) {
     while (true) {
         if (match(TokenType::LeftBracket)) {
             auto idxNode =
@@ -314,7 +404,7 @@ ASTNodePtr Parser::parsePostfix(ASTNodePtr lhs) {
             idxNode->addChild(std::move(lhs));
             idxNode->addChild(parseSliceOrExpr());
             expect(TokenType::RightBracket, "Expected ']' after index");
-            lhs = std::move(idxNode);
+            lhs = finish(std::move(idxNode), first);
         } else if (match(TokenType::LeftParen)) {
             auto callNode =
                 std::make_unique<ASTNode>(NodeType::FunctionCall, lhs->value);
@@ -322,7 +412,7 @@ ASTNodePtr Parser::parsePostfix(ASTNodePtr lhs) {
             if (!check(TokenType::RightParen))
                 callNode->addChild(parseArgumentList());
             expect(TokenType::RightParen, "Expected ')' after arguments");
-            lhs = std::move(callNode);
+            lhs = finish(std::move(callNode), first);
         } else
             break;
     }
@@ -330,6 +420,7 @@ ASTNodePtr Parser::parsePostfix(ASTNodePtr lhs) {
 }
 
 ASTNodePtr Parser::parsePrimary() {
+    size_t first = index_;
     if (match(TokenType::Function)) {
         auto n = std::make_unique<ASTNode>(NodeType::FunctionDefinition);
         expect(TokenType::LeftParen, "Expected '(' after 'function'");
@@ -339,13 +430,13 @@ ASTNodePtr Parser::parsePrimary() {
         if (check(TokenType::Return)) n->addChild(parseReturn());
         expect(TokenType::End, "Expected 'end'");
         expect(TokenType::Function, "Expected 'function'");
-        return n;
+        return finish(std::move(n), first);
     }
 
     if (match(TokenType::LeftParen)) {
         auto n = parseExpression();
         expect(TokenType::RightParen, "Expected ')'");
-        return parsePostfix(std::move(n));
+        return parsePostfix(std::move(n), first);
     }
 
     if (match(TokenType::Number) || match(TokenType::String) ||
@@ -354,7 +445,7 @@ ASTNodePtr Parser::parsePrimary() {
         auto vt = NodeType::Literal;
         if (t.type == TokenType::Boolean) vt = NodeType::Boolean;
         if (t.type == TokenType::Nil) vt = NodeType::Nil;
-        return std::make_unique<ASTNode>(vt, t.lexeme);
+        return leaf(vt, t);
     }
 
     if (match(TokenType::LeftBracket)) {
@@ -384,13 +475,12 @@ ASTNodePtr Parser::parsePrimary() {
         }
 
         expect(TokenType::RightBracket, "Expected ']' after list literal");
-        return parsePostfix(std::move(l));
+        return parsePostfix(finish(std::move(l), first), first);
     }
 
     if (match(TokenType::Identifier)) {
         auto t = tokens_[index_ - 1];
-        return parsePostfix(
-            std::make_unique<ASTNode>(NodeType::Identifier, t.lexeme));
+        return parsePostfix(leaf(NodeType::Identifier, t), first);
     }
 
     throw ParseError("Unexpected token '" + peek().lexeme + "' at line " +
@@ -398,13 +488,14 @@ ASTNodePtr Parser::parsePrimary() {
 }
 
 ASTNodePtr Parser::parseLiteral() {
+    size_t first = index_;
     if (match(TokenType::Number) || match(TokenType::String) ||
         match(TokenType::Boolean) || match(TokenType::Nil)) {
         auto tok = tokens_[index_ - 1];
         NodeType t = NodeType::Literal;
         if (tok.type == TokenType::Boolean) t = NodeType::Boolean;
         if (tok.type == TokenType::Nil) t = NodeType::Nil;
-        return std::make_unique<ASTNode>(t, tok.lexeme);
+        return leaf(t, tok);
     }
     if (match(TokenType::LeftBracket)) {
         auto listNode = std::make_unique<ASTNode>(NodeType::ListLiteral);
@@ -417,36 +508,37 @@ ASTNodePtr Parser::parseLiteral() {
             }
         }
         expect(TokenType::RightBracket, "Expected ']' after list literal");
-        return listNode;
+        return finish(std::move(listNode), first);
     }
     if (match(TokenType::Identifier)) {
-        auto tok = tokens_[index_ - 1];
-        return std::make_unique<ASTNode>(NodeType::Identifier, tok.lexeme);
+        return leaf(NodeType::Identifier, tokens_[index_ - 1]);
     }
     throw ParseError("Unexpected token '" + peek().lexeme + "'");
 }
 
 ASTNodePtr Parser::parseParameterList() {
+    size_t first = index_;
     auto node = std::make_unique<ASTNode>(NodeType::ParameterList);
     do {
         auto tok = get();
         if (tok.type != TokenType::Identifier)
             throw ParseError("Expected parameter name");
-        node->addChild(
-            std::make_unique<ASTNode>(NodeType::Identifier, tok.lexeme));
+        node->addChild(leaf(NodeType::Identifier, tok));
     } while (match(TokenType::Comma));
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseArgumentList() {
+    size_t first = index_;
     auto node = std::make_unique<ASTNode>(NodeType::ArgumentList);
     do {
         node->addChild(parseExpression());
     } while (match(TokenType::Comma));
-    return node;
+    return finish(std::move(node), first);
 }
 
 ASTNodePtr Parser::parseSliceOrExpr() {
+    size_t first = index_;
     if (check(TokenType::RightBracket)) {
         return std::make_unique<ASTNode>(NodeType::Nil);
     }
@@ -473,7 +565,7 @@ ASTNodePtr Parser::parseSliceOrExpr() {
         } else {
             slice->addChild(std::make_unique<ASTNode>(NodeType::Nil));
         }
-        return slice;
+        return finish(std::move(slice), first);
     }
 
     if (hasStart) {
@@ -0,0 +1,141 @@
+#include "itmoscript/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace itmoscript {
+
+namespace {
+
+// Frame name of code outside any function.
+constexpr std::string_view kTopLevel = "<main>";
+
+}  // namespace
+
+Profiler::Profiler(std::chrono::microseconds interval)
+    : interval_(std::max(interval, std::chrono::microseconds(1))) {}
+
+Profiler::~Profiler() { stop(); }
+
+void Profiler::start() {
+    if (timer_.joinable()) return;
+    stopping_ = false;
+    timer_ = std::thread([this] { tick(); });
+}
+
+void Profiler::stop() {
+    if (!timer_.joinable()) return;
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    timer_.join();
+    // Ticks after the last check belong to no stack.
+    ticks_.store(seen_, std::memory_order_relaxed);
+}
+
+void Profiler::tick() {
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock lock(mutex_);
+    while (true) {
+        next += interval_;
+        if (wake_.wait_until(lock, next, [this] { return stopping_; })) {
+            return;
+        }
+        ticks_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::sample(const std::vector<const std::string*>& stack,
+                      int line) {
+    std::uint64_t now = ticks_.load(std::memory_order_relaxed);
+    std::uint64_t weight = now - seen_;
+    seen_ = now;
+    if (weight == 0) return;
+    scratch_.clear();
+    for (const auto* name : stack) scratch_.push_back(*name);
+    auto found = stacks_.find(scratch_);
+    if (found == stacks_.end()) {
+        found = stacks_
+                    .emplace(std::vector<std::string>(scratch_.begin(),
+                                                      scratch_.end()),
+                             Samples{})
+                    .first;
+    }
+    found->second.count += weight;
+    found->second.byLine[line] += weight;
+}
+
+void Profiler::writeReport(std::ostream& os) const {
+    struct Counts {
+        std::uint64_t self = 0;
+        std::uint64_t total = 0;
+    };
+    std::unordered_map<std::string_view, Counts> byName;
+    std::map<std::pair<std::string_view, int>, std::uint64_t> byLine;
+    std::uint64_t all = 0;
+    for (const auto& [stack, samples] : stacks_) {
+        std::uint64_t n = samples.count;
+        all += n;
+        std::string_view leaf = stack.empty() ? kTopLevel : stack.back();
+        byName[leaf].self += n;
+        for (const auto& [line, k] : samples.byLine) byLine[{leaf, line}] += k;
+        // Recursive functions count once per sample towards their total.
+        std::set<std::string_view> onStack(stack.begin(), stack.end());
+        onStack.insert(kTopLevel);
+        for (auto name : onStack) byName[name].total += n;
+    }
+
+    std::vector<std::pair<std::string_view, Counts>> rows(byName.begin(),
+                                                          byName.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        if (a.second.self != b.second.self) {
+            return a.second.self > b.second.self;
+        }
+        if (a.second.total != b.second.total) {
+            return a.second.total > b.second.total;
+        }
+        return a.first < b.first;
+    });
+
+    auto percent = [all](std::uint64_t n) {
+        char buf[16];
+        std::snprintf(buf, sizeof buf, "%6.1f%%",
+                      all ? 100.0 * n / all : 0.0);
+        return std::string(buf);
+    };
+    os << "samples: " << all << " (every " << interval_.count() << " us)\n";
+    os << "  self%  total%  function\n";
+    for (const auto& [name, c] : rows) {
+        os << percent(c.self) << " " << percent(c.total) << "  " << name
+           << "\n";
+    }
+
+    std::vector<std::pair<std::pair<std::string_view, int>, std::uint64_t>>
+        lines(byLine.begin(), byLine.end());
+    std::stable_sort(lines.begin(), lines.end(),
+                     [](const auto& a, const auto& b) {
+                         return a.second > b.second;
+                     });
+    os << "  self%  line  function\n";
+    for (const auto& [at, n] : lines) {
+        char line[16] = "     ?";
+        if (at.second > 0) std::snprintf(line, sizeof line, "%6d", at.second);
+        os << percent(n) << line << "  " << at.first << "\n";
+    }
+}
+
+void Profiler::writeFolded(std::ostream& os) const {
+    for (const auto& [stack, samples] : stacks_) {
+        os << kTopLevel;
+        for (const auto& name : stack) os << ";" << name;
+        os << " " << samples.count << "\n";
+    }
+}
+
+}  // namespace itmoscript
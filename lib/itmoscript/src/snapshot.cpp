@@ -0,0 +1,706 @@
+#include "itmoscript/snapshot.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "itmoscript/aet.h"
+#include "itmoscript/ast.h"
+#include "itmoscript/environment.h"
+#include "itmoscript/heap.h"
+#include "itmoscript/ordered_map.h"
+#include "itmoscript/symbol.h"
+#include "itmoscript/value.h"
+
+#if __has_include(<sys/mman.h>)
+#define ITMOSCRIPT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace itmoscript::snapshot {
+
+namespace {
+
+// A snapshot is the magic, the format version, a table of objects, the
+// variables and a checksum of everything before it. Values are written
+// inline when they are scalars and as the index of an object otherwise; an
+// object only refers to objects before it. Integers are varints (signed
+// ones zigzag-encoded), doubles and the checksum their bits in
+// little-endian order.
+constexpr std::string_view kMagic = "ITMOSNAP";
+constexpr std::uint64_t kVersion = 2;
+constexpr size_t kChecksumSize = 8;
+
+// 64-bit FNV-1a. A damaged file can still be a well-formed one, e.g. with
+// another name in an assignment, so damage is caught before anything is
+// read.
+std::uint64_t checksum(std::string_view bytes) {
+    std::uint64_t h = 0xcbf29ce484222325;
+    for (char c : bytes) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+enum class Tag : std::uint8_t { Nil, False, True, Integer, Double, Object };
+
+enum class Kind : std::uint8_t {
+    String,
+    List,
+    // A list packed as doubles.
+    Array,
+    Deque,
+    Set,
+    Map,
+    Heap,
+    Builtin,
+    // The syntax tree of a function definition and its label; compiled
+    // once for all functions that refer to it.
+    Definition,
+    Function,
+};
+
+class Writer {
+   public:
+    void byte(std::uint8_t b) { out_.push_back(static_cast<char>(b)); }
+
+    void varint(std::uint64_t x) {
+        while (x >= 0x80) {
+            byte(static_cast<std::uint8_t>(x | 0x80));
+            x >>= 7;
+        }
+        byte(static_cast<std::uint8_t>(x));
+    }
+
+    void integer(std::int64_t x) {
+        varint((static_cast<std::uint64_t>(x) << 1) ^
+               static_cast<std::uint64_t>(x >> 63));
+    }
+
+    void number(double x) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof bits);
+        for (int i = 0; i < 8; ++i) {
+            byte(static_cast<std::uint8_t>(bits >> 8 * i));
+        }
+    }
+
+    void text(std::string_view s) {
+        varint(s.size());
+        out_.append(s);
+    }
+
+    void append(const Writer& w) { out_ += w.out_; }
+
+    std::string& bytes() noexcept { return out_; }
+
+   private:
+    std::string out_;
+};
+
+class Reader {
+   public:
+    explicit Reader(std::string_view in) : in_(in) {}
+
+    std::uint8_t byte() {
+        need(1);
+        return static_cast<std::uint8_t>(in_[pos_++]);
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t x = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint8_t b = byte();
+            x |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return x;
+        }
+        malformed();
+    }
+
+    // A count of items that each take at least one byte.
+    size_t count() {
+        std::uint64_t n = varint();
+        if (n > in_.size() - pos_) malformed();
+        return static_cast<size_t>(n);
+    }
+
+    std::int64_t integer() {
+        std::uint64_t z = varint();
+        return static_cast<std::int64_t>((z >> 1) ^ (~(z & 1) + 1));
+    }
+
+    double number() {
+        need(8);
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= static_cast<std::uint64_t>(
+                        static_cast<std::uint8_t>(in_[pos_++]))
+                    << 8 * i;
+        }
+        double x;
+        std::memcpy(&x, &bits, sizeof x);
+        return x;
+    }
+
+    std::string_view text() {
+        size_t n = count();
+        auto s = in_.substr(pos_, n);
+        pos_ += n;
+        return s;
+    }
+
+    bool done() const noexcept { return pos_ == in_.size(); }
+
+    [[noreturn]] static void malformed() {
+        throw std::runtime_error("Malformed snapshot");
+    }
+
+   private:
+    void need(size_t n) const {
+        if (in_.size() - pos_ < n) malformed();
+    }
+
+    std::string_view in_;
+    size_t pos_ = 0;
+};
+
+void writeTree(const ASTNode& node, Writer& w) {
+    w.byte(static_cast<std::uint8_t>(node.type));
+    w.text(node.value);
+    for (int x : {node.span.line, node.span.column, node.span.endLine,
+                  node.span.endColumn}) {
+        w.varint(static_cast<std::uint64_t>(x));
+    }
+    w.varint(node.children.size());
+    for (const auto& child : node.children) writeTree(*child, w);
+}
+
+bool isStatement(const ASTNode& node);
+bool isExpression(const ASTNode& node);
+
+bool allOf(const ASTNode& node, bool (*check)(const ASTNode&)) {
+    return std::all_of(node.children.begin(), node.children.end(),
+                       [check](const auto& c) { return check(*c); });
+}
+
+bool isName(const ASTNode& node) {
+    return node.type == NodeType::Identifier && node.children.empty();
+}
+
+bool isBlock(const ASTNode& node) {
+    return node.type == NodeType::StatementList && allOf(node, isStatement);
+}
+
+// Parameters, a body and an optional return, as the parser makes them.
+bool isDefinition(const ASTNode& node) {
+    const auto& c = node.children;
+    size_t i = 0;
+    if (!c.empty() && c[0]->type == NodeType::ParameterList) {
+        if (c[0]->children.empty() || !allOf(*c[0], isName)) return false;
+        ++i;
+    }
+    if (i == c.size() || !isBlock(*c[i++])) return false;
+    if (i < c.size() && c[i]->type == NodeType::Return && isStatement(*c[i])) {
+        ++i;
+    }
+    return i == c.size();
+}
+
+bool isExpression(const ASTNode& node) {
+    const auto& c = node.children;
+    switch (node.type) {
+        case NodeType::Literal:
+        case NodeType::Identifier:
+        case NodeType::Nil:
+        case NodeType::Boolean:
+            return c.empty();
+        case NodeType::UnaryOp:
+            return c.size() == 1 && isExpression(*c[0]);
+        case NodeType::BinaryOp:
+            return c.size() == 2 && isExpression(*c[0]) && isExpression(*c[1]);
+        case NodeType::ListLiteral:
+            return allOf(node, isExpression);
+        case NodeType::FunctionCall:
+            if (c.empty() || c.size() > 2 || !isExpression(*c[0])) return false;
+            return c.size() == 1 ||
+                   (c[1]->type == NodeType::ArgumentList &&
+                    !c[1]->children.empty() && allOf(*c[1], isExpression));
+        case NodeType::FunctionDefinition:
+            return isDefinition(node);
+        default:
+            return false;
+    }
+}
+
+bool isStatement(const ASTNode& node) {
+    const auto& c = node.children;
+    switch (node.type) {
+        case NodeType::Assignment:
+            return c.size() == 3 && isName(*c[0]) &&
+                   c[0]->value == node.value && isName(*c[1]) &&
+                   isExpression(*c[2]);
+        case NodeType::Return:
+            return c.size() == 1 && isExpression(*c[0]);
+        case NodeType::Break:
+        case NodeType::Continue:
+            return c.empty();
+        case NodeType::If:
+            if (c.size() < 2 || !isExpression(*c[0]) || !isBlock(*c[1])) {
+                return false;
+            }
+            for (size_t i = 2; i < c.size(); ++i) {
+                const auto& branch = *c[i];
+                bool ok = branch.type == NodeType::ElseIf
+                              ? branch.children.size() == 2 &&
+                                    isExpression(*branch.children[0]) &&
+                                    isBlock(*branch.children[1])
+                              : branch.type == NodeType::Else &&
+                                    i + 1 == c.size() &&
+                                    branch.children.size() == 1 &&
+                                    isBlock(*branch.children[0]);
+                if (!ok) return false;
+            }
+            return true;
+        case NodeType::While:
+            return c.size() == 2 && isExpression(*c[0]) && isBlock(*c[1]);
+        case NodeType::For:
+            return c.size() == 3 && isName(*c[0]) && isExpression(*c[1]) &&
+                   isBlock(*c[2]);
+        case NodeType::StatementList:
+            return isBlock(node);
+        default:
+            return isExpression(node);
+    }
+}
+
+std::unique_ptr<ASTNode> readTree(Reader& r, int depth = 0) {
+    // Deeper than any parser would nest; keeps the recursion bounded.
+    if (depth > 10000) Reader::malformed();
+    std::uint8_t type = r.byte();
+    if (type > static_cast<std::uint8_t>(NodeType::Boolean)) {
+        Reader::malformed();
+    }
+    auto node = std::make_unique<ASTNode>(static_cast<NodeType>(type),
+                                          std::string(r.text()));
+    auto field = [&r] {
+        std::uint64_t x = r.varint();
+        if (x > std::numeric_limits<int>::max()) Reader::malformed();
+        return static_cast<int>(x);
+    };
+    node->span = {field(), field(), field(), field()};
+    size_t n = r.count();
+    node->children.reserve(n);
+    for (size_t i = 0; i < n; ++i) node->addChild(readTree(r, depth + 1));
+    return node;
+}
+
+// Writes the object table while it walks the values, children first.
+class Capture {
+   public:
+    explicit Capture(const Environment::Frame& globals) {
+        for (const auto& [name, value] : globals) {
+            if (value.type() != Value::Type::Function) continue;
+            // Copies of a builtin share its callable, wherever they were
+            // assigned; names of one builtin restore the same function.
+            builtins_.emplace(&value.asFunction(), name.str());
+        }
+    }
+
+    std::string run(const Environment::Frame& vars) {
+        Writer body;
+        body.varint(vars.size());
+        for (const auto& [name, value] : vars) {
+            body.text(name.str());
+            write(value, body);
+        }
+        Writer out;
+        out.bytes().append(kMagic);
+        out.varint(kVersion);
+        out.varint(count_);
+        out.append(objects_);
+        out.append(body);
+        std::uint64_t sum = checksum(out.bytes());
+        for (size_t i = 0; i < kChecksumSize; ++i) {
+            out.byte(static_cast<std::uint8_t>(sum >> 8 * i));
+        }
+        return std::move(out.bytes());
+    }
+
+   private:
+    using Key = std::tuple<Kind, const void*, size_t>;
+
+    void write(const Value& v, Writer& w) {
+        switch (v.type()) {
+            case Value::Type::Nil:
+                w.byte(static_cast<std::uint8_t>(Tag::Nil));
+                return;
+            case Value::Type::Boolean:
+                w.byte(static_cast<std::uint8_t>(v.asBoolean() ? Tag::True
+                                                                : Tag::False));
+                return;
+            case Value::Type::Number:
+                if (v.isInteger()) {
+                    w.byte(static_cast<std::uint8_t>(Tag::Integer));
+                    w.integer(v.asInteger());
+                } else {
+                    w.byte(static_cast<std::uint8_t>(Tag::Double));
+                    w.number(v.asNumber());
+                }
+                return;
+            default:
+                w.byte(static_cast<std::uint8_t>(Tag::Object));
+                w.varint(object(v));
+        }
+    }
+
+    // Index of the object holding v, which is added unless an earlier value
+    // shares it.
+    size_t object(const Value& v) {
+        if (v.type() == Value::Type::Function) return function(v);
+        Key key = identity(v);
+        if (std::get<1>(key)) {
+            auto found = seen_.find(key);
+            if (found != seen_.end()) return found->second;
+        }
+        Writer w;
+        encode(v, w);
+        size_t index = add(w);
+        if (std::get<1>(key)) seen_.emplace(key, index);
+        return index;
+    }
+
+    size_t add(const Writer& record) {
+        objects_.append(record);
+        return count_++;
+    }
+
+    // What copies of v share, or a null pointer when v is stored anew.
+    static Key identity(const Value& v) {
+        switch (v.type()) {
+            case Value::Type::String: {
+                auto s = v.asString();
+                if (s.empty()) break;
+                return {Kind::String, s.data(), s.size()};
+            }
+            case Value::Type::List: {
+                auto list = v.asList();
+                if (list.empty() || list.isPersistent()) break;
+                if (list.isPacked()) {
+                    return {Kind::Array, list.numbers().data(), list.size()};
+                }
+                return {Kind::List, list.values().data(), list.size()};
+            }
+            case Value::Type::Deque:
+                return {Kind::Deque, &v.asDeque(), 0};
+            case Value::Type::OrderedMap:
+                return {Kind::Map, &v.asOrderedMap(), 0};
+            case Value::Type::Heap:
+                return {Kind::Heap, &v.asHeap(), 0};
+            default:
+                break;
+        }
+        return {Kind::String, nullptr, 0};
+    }
+
+    void encode(const Value& v, Writer& w) {
+        auto kind = [&w](Kind k) { w.byte(static_cast<std::uint8_t>(k)); };
+        switch (v.type()) {
+            case Value::Type::String:
+                kind(Kind::String);
+                w.text(v.asString());
+                return;
+            case Value::Type::List: {
+                auto list = v.asList();
+                if (list.isPacked()) {
+                    kind(Kind::Array);
+                    w.varint(list.size());
+                    for (double x : list.numbers()) w.number(x);
+                    return;
+                }
+                kind(Kind::List);
+                w.varint(list.size());
+                for (const Value& e : list) write(e, w);
+                return;
+            }
+            case Value::Type::Deque:
+                kind(Kind::Deque);
+                w.varint(v.asDeque().size());
+                for (const Value& e : v.asDeque()) write(e, w);
+                return;
+            case Value::Type::OrderedMap: {
+                const OrderedMap& m = v.asOrderedMap();
+                kind(m.isSet() ? Kind::Set : Kind::Map);
+                w.varint(m.size());
+                for (size_t i = 0; i < m.size(); ++i) {
+                    write(m.at(i).key, w);
+                    if (!m.isSet()) write(m.at(i).value, w);
+                }
+                return;
+            }
+            case Value::Type::Heap: {
+                const Heap& h = v.asHeap();
+                kind(Kind::Heap);
+                write(h.keyFunction(), w);
+                w.varint(h.size());
+                for (const auto& [key, item] : h.keyed()) {
+                    write(key, w);
+                    write(item, w);
+                }
+                return;
+            }
+            default:
+                throw std::runtime_error("cannot save value in a snapshot");
+        }
+    }
+
+    size_t function(const Value& fn) {
+        Writer w;
+        FunctionImage image;
+        if (!imageOf(fn, image)) {
+            auto found = builtins_.find(&fn.asFunction());
+            if (found == builtins_.end()) {
+                throw std::runtime_error(
+                    "Cannot save a function that is not a global builtin "
+                    "in a snapshot");
+            }
+            w.byte(static_cast<std::uint8_t>(Kind::Builtin));
+            w.text(found->second);
+            return add(w);
+        }
+        Key key{Kind::Function, image.id, 0};
+        auto found = seen_.find(key);
+        if (found != seen_.end()) return found->second;
+
+        size_t definition = define(image);
+        w.byte(static_cast<std::uint8_t>(Kind::Function));
+        w.varint(definition);
+        w.varint(image.captured.size());
+        for (const auto& [name, value] : image.captured) {
+            w.text(name.str());
+            write(value, w);
+        }
+        size_t index = add(w);
+        seen_.emplace(key, index);
+        return index;
+    }
+
+    size_t define(const FunctionImage& image) {
+        Key key{Kind::Definition, image.definition.get(), 0};
+        auto found = seen_.find(key);
+        if (found != seen_.end()) return found->second;
+        Writer w;
+        w.byte(static_cast<std::uint8_t>(Kind::Definition));
+        w.text(image.label);
+        writeTree(*image.definition, w);
+        size_t index = add(w);
+        seen_.emplace(key, index);
+        return index;
+    }
+
+    Writer objects_;
+    size_t count_ = 0;
+    std::map<Key, size_t> seen_;
+    std::unordered_map<const Value::FuncType*, std::string> builtins_;
+};
+
+}  // namespace
+
+std::string capture(const Environment& env) {
+    return Capture(env.getGlobals()).run(env.getLocals());
+}
+
+void restore(std::string_view bytes, Environment& env) {
+    if (bytes.substr(0, kMagic.size()) != kMagic) Reader::malformed();
+    if (Reader(bytes.substr(kMagic.size())).varint() != kVersion) {
+        throw std::runtime_error("Unsupported snapshot version");
+    }
+    if (bytes.size() < kMagic.size() + kChecksumSize) Reader::malformed();
+    size_t end = bytes.size() - kChecksumSize;
+    std::uint64_t sum = 0;
+    for (size_t i = 0; i < kChecksumSize; ++i) {
+        sum |= static_cast<std::uint64_t>(
+                   static_cast<std::uint8_t>(bytes[end + i]))
+               << 8 * i;
+    }
+    if (sum != checksum(bytes.substr(0, end))) Reader::malformed();
+    Reader r(bytes.substr(kMagic.size(), end - kMagic.size()));
+    r.varint();  // The version, checked above.
+
+    std::vector<Value> objects;
+    std::unordered_map<size_t, std::shared_ptr<const AETNode>> functions;
+    auto read = [&]() -> Value {
+        switch (static_cast<Tag>(r.byte())) {
+            case Tag::Nil:
+                return Value::makeNil();
+            case Tag::False:
+                return Value::makeBoolean(false);
+            case Tag::True:
+                return Value::makeBoolean(true);
+            case Tag::Integer:
+                return Value::makeInteger(r.integer());
+            case Tag::Double:
+                return Value::makeNumber(r.number());
+            case Tag::Object: {
+                std::uint64_t i = r.varint();
+                if (i >= objects.size() || functions.count(i)) {
+                    Reader::malformed();
+                }
+                return objects[i];
+            }
+        }
+        Reader::malformed();
+    };
+    // Variables: a count, then names with their values.
+    auto readVariables = [&] {
+        std::vector<std::pair<Symbol, Value>> vars;
+        for (size_t k = r.count(); k > 0; --k) {
+            Symbol name(r.text());
+            vars.emplace_back(name, read());
+        }
+        return vars;
+    };
+
+    size_t n = r.count();
+    objects.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Value v;
+        auto kind = static_cast<Kind>(r.byte());
+        switch (kind) {
+            case Kind::String:
+                v = Value::makeString(std::string(r.text()));
+                break;
+            case Kind::List: {
+                Value::ListType list(r.count());
+                for (auto& e : list) e = read();
+                v = Value::makeList(std::move(list));
+                break;
+            }
+            case Kind::Array: {
+                Value::NumArray array(r.count());
+                for (auto& x : array) x = r.number();
+                v = Value::makeArray(std::move(array));
+                break;
+            }
+            case Kind::Deque: {
+                Value::DequeType deque(r.count());
+                for (auto& e : deque) e = read();
+                v = Value::makeDeque(std::move(deque));
+                break;
+            }
+            case Kind::Set:
+            case Kind::Map: {
+                OrderedMap m(kind == Kind::Set);
+                for (size_t k = r.count(); k > 0; --k) {
+                    Value key = read();
+                    m.insert(std::move(key),
+                             kind == Kind::Set ? Value::makeNil() : read());
+                }
+                v = Value::makeOrderedMap(std::move(m));
+                break;
+            }
+            case Kind::Heap: {
+                Value keyFn = read();
+                if (keyFn.type() != Value::Type::Nil &&
+                    keyFn.type() != Value::Type::Function) {
+                    Reader::malformed();
+                }
+                Heap h(std::move(keyFn));
+                for (size_t k = r.count(); k > 0; --k) {
+                    Value key = read();
+                    h.push(read(), std::move(key));
+                }
+                v = Value::makeHeap(std::move(h));
+                break;
+            }
+            case Kind::Builtin: {
+                std::string_view name = r.text();
+                const auto& globals = env.getGlobals();
+                auto found = globals.find(Symbol(name));
+                if (found == globals.end()) {
+                    throw std::runtime_error("Snapshot refers to unknown "
+                                             "builtin '" +
+                                             std::string(name) + "'");
+                }
+                v = found->second;
+                break;
+            }
+            case Kind::Definition: {
+                std::string label(r.text());
+                std::shared_ptr<const ASTNode> tree = readTree(r);
+                // buildAET trusts the shapes the parser gives trees.
+                if (tree->type != NodeType::FunctionDefinition ||
+                    !isDefinition(*tree)) {
+                    Reader::malformed();
+                }
+                functions.emplace(i, buildFunction(std::move(tree), label));
+                break;
+            }
+            case Kind::Function: {
+                auto found = functions.find(r.varint());
+                if (found == functions.end()) Reader::malformed();
+                v = functionFrom(found->second, readVariables());
+                break;
+            }
+            default:
+                Reader::malformed();
+        }
+        objects.push_back(std::move(v));
+    }
+
+    for (auto& [name, value] : readVariables()) env.set(name, std::move(value));
+    if (!r.done()) Reader::malformed();
+}
+
+void save(const Environment& env, const std::string& path) {
+    std::string bytes = capture(env);
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) throw std::runtime_error("Cannot write snapshot: " + path);
+}
+
+void load(const std::string& path, Environment& env) {
+#ifdef ITMOSCRIPT_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open snapshot: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        Reader::malformed();
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot: " + path);
+    }
+    // Unmaps on the way out, also when restoring throws.
+    struct Mapping {
+        void* data;
+        size_t size;
+        ~Mapping() { ::munmap(data, size); }
+    } mapping{data, size};
+    restore({static_cast<const char*>(mapping.data), size}, env);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open snapshot: " + path);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    restore(bytes, env);
+#endif
+}
+
+}  // namespace itmoscript::snapshot
@@ -0,0 +1,121 @@
+#include "itmoscript/statement_reader.h"
+
+#include <algorithm>
+
+#include "itmoscript/lexer.h"
+#include "itmoscript/parser.h"
+
+namespace itmoscript {
+
+namespace {
+
+// Whether a string literal is still open at the end of line, given whether
+// one was open at its start.
+bool stringOpenAfter(const std::string& line, bool open) {
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (open) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == '"') {
+                open = false;
+            }
+        } else if (c == '"') {
+            open = true;
+        } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+            break;
+        }
+    }
+    return open;
+}
+
+// Change in block nesting made by tokens[i]: if, while, for and function
+// open a block and end closes one. The keyword after end, and the if of
+// else if, open nothing.
+int nesting(const std::vector<Token>& tokens, size_t i) {
+    TokenType before = i > 0 ? tokens[i - 1].type : TokenType::NewLine;
+    switch (tokens[i].type) {
+        case TokenType::End:
+            return -1;
+        case TokenType::If:
+            return before == TokenType::End || before == TokenType::Else ? 0
+                                                                         : 1;
+        case TokenType::While:
+        case TokenType::For:
+        case TokenType::Function:
+            return before == TokenType::End ? 0 : 1;
+        default:
+            return 0;
+    }
+}
+
+// Change in bracket nesting made by a token. List literals are the only
+// place the parser lets an expression go on over a new line.
+int bracketing(const Token& token) {
+    switch (token.type) {
+        case TokenType::LeftBracket:
+            return 1;
+        case TokenType::RightBracket:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+}  // namespace
+
+ASTNodePtr StatementReader::next() {
+    tokens_.clear();
+    text_.clear();
+    firstLine_ = line_ + 1;
+
+    // Lines lexed together: a string may run on over several.
+    std::string chunk;
+    int chunkLine = firstLine_;
+    bool inString = false;
+    int depth = 0;
+    int brackets = 0;
+    std::string line;
+    while (true) {
+        if (prompt_) prompt_(!text_.empty());
+        if (!std::getline(in_, line)) break;
+        ++line_;
+        line += '\n';
+        text_ += line;
+        chunk += line;
+        inString = stringOpenAfter(line, inString);
+        if (inString) continue;
+
+        auto tokens = Lexer(chunk, chunkLine).tokenize();
+        tokens.pop_back();  // EndOfFile
+        size_t start = tokens_.size();
+        tokens_.insert(tokens_.end(), std::make_move_iterator(tokens.begin()),
+                       std::make_move_iterator(tokens.end()));
+        for (size_t i = start; i < tokens_.size(); ++i) {
+            depth += nesting(tokens_, i);
+            brackets += bracketing(tokens_[i]);
+        }
+        chunk.clear();
+        chunkLine = line_ + 1;
+
+        if (depth > 0 || brackets > 0) continue;
+        bool blank = std::all_of(tokens_.begin(), tokens_.end(), [](auto& t) {
+            return t.type == TokenType::NewLine;
+        });
+        if (!blank) break;
+        // Blank lines and comments between statements.
+        tokens_.clear();
+        text_.clear();
+        firstLine_ = line_ + 1;
+    }
+
+    if (!chunk.empty()) {
+        // Unterminated string at the end of the input; the lexer says so.
+        Lexer(chunk, chunkLine).tokenize();
+    }
+    if (tokens_.empty()) return nullptr;
+    tokens_.push_back({TokenType::EndOfFile, "", line_ + 1, 1});
+    return Parser(tokens_).parseProgram();
+}
+
+}  // namespace itmoscript
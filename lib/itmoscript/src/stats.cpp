@@ -0,0 +1,83 @@
+#include "itmoscript/stats.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace itmoscript::stats {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<detail::Block*> live;
+    // Counts of threads that have finished.
+    Snapshot retired{};
+};
+
+// Leaked so that threads finishing during static destruction still find
+// it.
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+// Owns a thread's block and folds it into the retired counts when the
+// thread exits.
+struct Owner {
+    std::unique_ptr<detail::Block> block = std::make_unique<detail::Block>();
+
+    ~Owner() {
+        Registry& r = registry();
+        std::lock_guard lock(r.mutex);
+        for (size_t i = 0; i < kCounters; ++i) {
+            r.retired[i] += block->counts[i].load(std::memory_order_relaxed);
+        }
+        std::erase(r.live, block.get());
+        detail::local = nullptr;
+    }
+};
+
+}  // namespace
+
+std::string_view name(Counter c) {
+    switch (c) {
+        case Counter::ValueCopies:
+            return "value_copies";
+        case Counter::StringBuffers:
+            return "string_buffers";
+        case Counter::ListBuffers:
+            return "list_buffers";
+        case Counter::BufferBytes:
+            return "buffer_bytes";
+        case Counter::FramePushes:
+            return "frame_pushes";
+        case Counter::Calls:
+            return "calls";
+    }
+    return "";
+}
+
+Snapshot read() {
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    Snapshot total = r.retired;
+    for (const detail::Block* b : r.live) {
+        for (size_t i = 0; i < kCounters; ++i) {
+            total[i] += b->counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+detail::Block& detail::registerThread() {
+    thread_local Owner owner;
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.live.push_back(owner.block.get());
+    local = owner.block.get();
+    return *local;
+}
+
+}  // namespace itmoscript::stats
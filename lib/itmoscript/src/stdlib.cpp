@@ -1,19 +1,389 @@
 #include "itmoscript/stdlib.h"
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cctype>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <random>
-#include <sstream>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "itmoscript/heap.h"
+#include "itmoscript/numeric.h"
+#include "itmoscript/ordered_map.h"
+#include "itmoscript/stats.h"
+#include "itmoscript/thread_pool.h"
 #include "itmoscript/value.h"
 
 namespace itmoscript {
 
+namespace {
+
+// Results of floor/ceil/round are whole numbers; keep them exact integers
+// unless they are out of int64 range.
+Value wholeNumber(double x) {
+    if (std::fabs(x) < 9223372036854775808.0)
+        return Value::makeInteger(static_cast<std::int64_t>(x));
+    return Value::makeNumber(x);
+}
+
+// Argument of the bit-counting builtins, as its 64-bit pattern.
+std::uint64_t bitsOf(const std::vector<Value>& args, const std::string& name) {
+    if (args.size() != 1 || args[0].type() != Value::Type::Number ||
+        (!args[0].isInteger() &&
+         std::trunc(args[0].asNumber()) != args[0].asNumber()))
+        throw std::runtime_error(name + " expects 1 integer arg");
+    return static_cast<std::uint64_t>(args[0].asInteger());
+}
+
+// Sort keys paired with the position of their element.
+template <typename Key>
+using KeyedOrder = std::vector<std::pair<Key, size_t>>;
+
+// Order-preserving unsigned images of numeric sort keys.
+std::uint64_t radixKey(std::int64_t x) {
+    return static_cast<std::uint64_t>(x) ^ (std::uint64_t{1} << 63);
+}
+
+std::uint64_t radixKey(double x) {
+    if (x == 0) x = 0.0;
+    auto bits = std::bit_cast<std::uint64_t>(x);
+    return (bits >> 63) ? ~bits : bits | (std::uint64_t{1} << 63);
+}
+
+// Stable LSD radix sort, one byte per pass. Passes where every key has the
+// same byte are skipped, so small integers take only a pass or two.
+void radixSort(KeyedOrder<std::uint64_t>& items) {
+    KeyedOrder<std::uint64_t> tmp(items.size());
+    for (int shift = 0; shift < 64 && !items.empty(); shift += 8) {
+        std::array<size_t, 256> pos{};
+        for (const auto& it : items) ++pos[(it.first >> shift) & 0xff];
+        if (pos[(items[0].first >> shift) & 0xff] == items.size()) continue;
+
+        size_t sum = 0;
+        for (auto& p : pos) sum += std::exchange(p, sum);
+        for (const auto& it : items) {
+            tmp[pos[(it.first >> shift) & 0xff]++] = it;
+        }
+        items.swap(tmp);
+    }
+}
+
+// Lists at least this long are sorted on the environment's thread pool.
+constexpr size_t kParallelSortThreshold = size_t{1} << 15;
+
+// Sorts (key, position) pairs; positions are unique, so the order is total
+// and the parallel and sequential paths agree.
+template <typename Key>
+void sortOrder(KeyedOrder<Key>& order, Environment& env) {
+    ThreadPool* pool =
+        order.size() >= kParallelSortThreshold ? env.pool() : nullptr;
+    if (pool) {
+        parallelStableSort(order, std::less<>{}, *pool);
+    } else {
+        std::sort(order.begin(), order.end());
+    }
+}
+
+// Moves the elements of src into the order given by order.
+template <typename Key>
+Value::ListType permuted(Value::ListType& src, const KeyedOrder<Key>& order) {
+    Value::ListType out;
+    out.reserve(order.size());
+    for (const auto& [key, i] : order) out.push_back(std::move(src[i]));
+    return out;
+}
+
+// Sorts lst by precomputed keys, which must be all numbers or all strings.
+// Ties keep their original order.
+Value::ListType sortByKeys(Value::ListType& lst, const std::vector<Value>& keys,
+                           Environment& env) {
+    auto allOf = [&](Value::Type t) {
+        return std::all_of(keys.begin(), keys.end(),
+                           [t](const Value& k) { return k.type() == t; });
+    };
+
+    if (allOf(Value::Type::Number)) {
+        bool ints = std::all_of(keys.begin(), keys.end(),
+                                [](const Value& k) { return k.isInteger(); });
+        KeyedOrder<std::uint64_t> order(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            order[i] = {ints ? radixKey(keys[i].asInteger())
+                             : radixKey(keys[i].asNumber()),
+                        i};
+        }
+        radixSort(order);
+        return permuted(lst, order);
+    }
+
+    if (allOf(Value::Type::String)) {
+        KeyedOrder<std::string_view> order(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            order[i] = {keys[i].asString(), i};
+        }
+        sortOrder(order, env);
+        return permuted(lst, order);
+    }
+
+    throw std::runtime_error("sort_by keys must be all numbers or all strings");
+}
+
+// Checks the (list, function, ...) arguments of the higher-order builtins.
+void expectListAndFunction(const std::vector<Value>& args, size_t minArgs,
+                           size_t maxArgs, const std::string& name) {
+    if (args.size() < minArgs || args.size() > maxArgs) {
+        throw std::runtime_error(
+            name + " expects " + std::to_string(minArgs) +
+            (minArgs == maxArgs ? "" : " or " + std::to_string(maxArgs)) +
+            " args");
+    }
+    if (args[0].type() != Value::Type::List) {
+        throw std::runtime_error(name + " first arg must be a list");
+    }
+    if (args[1].type() != Value::Type::Function) {
+        throw std::runtime_error(name + " second arg must be a function");
+    }
+}
+
+// Applies fn to lst[from, to) into the same positions of out, refilling one
+// argument buffer; a function call moves its arguments into its frame.
+void mapRange(Value::ListView lst, const Value::FuncType& fn,
+              Environment& env, Value::ListType& out, size_t from,
+              size_t to) {
+    std::vector<Value> callArgs(1);
+    for (size_t i = from; i < to; ++i) {
+        callArgs[0] = lst[i];
+        out[i] = fn(callArgs, env);
+    }
+}
+
+// Calls a predicate through the caller's reused argument buffer.
+bool test(const Value::FuncType& pred, std::vector<Value>& callArgs,
+          Environment& env, const std::string& name) {
+    Value result = pred(callArgs, env);
+    if (result.type() != Value::Type::Boolean) {
+        throw std::runtime_error(name + " predicate must return boolean");
+    }
+    return result.asBoolean();
+}
+
+// Checks that every element is a number; true when all of them are exact
+// integers, which the numeric builtins then combine without rounding.
+bool expectNumbers(Value::ListView lst, const std::string& name) {
+    if (lst.isPacked()) {
+        auto xs = lst.numbers();
+        return std::all_of(xs.begin(), xs.end(), [](double x) {
+            return Value::unpacked(x).isInteger();
+        });
+    }
+    bool ints = true;
+    for (const auto& v : lst) {
+        if (v.type() != Value::Type::Number) {
+            throw std::runtime_error(name + " expects numbers");
+        }
+        ints = ints && v.isInteger();
+    }
+    return ints;
+}
+
+// The elements of a numeric list as the contiguous doubles the kernels take:
+// the buffer of a packed list, or a copy made into scratch.
+std::span<const double> doublesOf(Value::ListView lst,
+                                  std::vector<double>& scratch) {
+    if (lst.isPacked()) return lst.numbers();
+    scratch.resize(lst.size());
+    for (size_t i = 0; i < lst.size(); ++i) scratch[i] = lst[i].asNumber();
+    return scratch;
+}
+
+Value::ListView listArg(const std::vector<Value>& args, size_t i,
+                        const std::string& name) {
+    if (args[i].type() != Value::Type::List) {
+        throw std::runtime_error(name + " expects a list");
+    }
+    return args[i].asList();
+}
+
+// Position of the first smallest (or largest) element of a numeric list.
+template <bool Max>
+size_t extremeIndex(Value::ListView lst, const std::string& name) {
+    if (lst.empty()) throw std::runtime_error(name + " of empty list");
+    if (expectNumbers(lst, name)) {
+        size_t best = 0;
+        for (size_t i = 1; i < lst.size(); ++i) {
+            std::int64_t x = lst[i].asInteger();
+            std::int64_t b = lst[best].asInteger();
+            if (Max ? x > b : x < b) best = i;
+        }
+        return best;
+    }
+    std::vector<double> scratch;
+    auto xs = doublesOf(lst, scratch);
+    return Max ? kernels::argmax(xs) : kernels::argmin(xs);
+}
+
+// min/max take either one list or the numbers themselves.
+template <bool Max>
+Value extremeOf(const std::vector<Value>& args, const std::string& name) {
+    if (args.size() == 1) {
+        auto lst = listArg(args, 0, name);
+        return lst[extremeIndex<Max>(lst, name)];
+    }
+    if (args.empty()) throw std::runtime_error(name + " expects args");
+    return args[extremeIndex<Max>(args, name)];
+}
+
+// Elementwise add/mul of two equal-length lists, or of a list and a number
+// applied to every element. Integer elements stay exact, as with + and *.
+template <bool Mul>
+Value elementwise(const std::vector<Value>& args, const std::string& name) {
+    if (args.size() != 2) throw std::runtime_error(name + " expects 2 args");
+    auto combine = [](const Value& a, const Value& b) {
+        std::int64_t r;
+        if (a.isInteger() && b.isInteger() &&
+            !(Mul ? mulOverflow(a.asInteger(), b.asInteger(), r)
+                  : addOverflow(a.asInteger(), b.asInteger(), r))) {
+            return Value::makeInteger(r);
+        }
+        return Value::makeNumber(Mul ? a.asNumber() * b.asNumber()
+                                     : a.asNumber() + b.asNumber());
+    };
+
+    bool aList = args[0].type() == Value::Type::List;
+    bool bList = args[1].type() == Value::Type::List;
+    if (!aList && !bList) {
+        expectNumbers(args, name);
+        return combine(args[0], args[1]);
+    }
+
+    // A number is seen as a one-element list and reused for every position.
+    auto a = aList ? args[0].asList() : Value::ListView(&args[0], 1);
+    auto b = bList ? args[1].asList() : Value::ListView(&args[1], 1);
+    if (aList && bList && a.size() != b.size()) {
+        throw std::runtime_error(name + " lists differ in length");
+    }
+    size_t n = aList ? a.size() : b.size();
+    bool ints = expectNumbers(a, name);
+    ints = expectNumbers(b, name) && ints;
+
+    if (ints) {
+        Value::ListType out;
+        out.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(combine(a[aList ? i : 0], b[bList ? i : 0]));
+        }
+        return Value::makeList(std::move(out));
+    }
+
+    std::vector<double> xScratch, yScratch;
+    auto widen = [n](Value::ListView v, std::vector<double>& scratch) {
+        if (v.size() == n) return doublesOf(v, scratch);
+        scratch.assign(n, v[0].asNumber());
+        return std::span<const double>(scratch);
+    };
+    auto xs = widen(a, xScratch);
+    auto ys = widen(b, yScratch);
+    Value::NumArray rs(n);
+    if (Mul) {
+        kernels::mul(xs, ys, rs);
+    } else {
+        kernels::add(xs, ys, rs);
+    }
+    return Value::makeArray(std::move(rs));
+}
+
+// Key of an item pushed onto h: what the heap's key function returns for
+// it, the priority of a [priority, payload] list, or the item itself.
+Value heapKey(const Heap& h, const Value& item, Environment& env) {
+    if (h.keyFunction().type() == Value::Type::Function) {
+        std::vector<Value> callArgs{item};
+        return h.keyFunction().asFunction()(callArgs, env);
+    }
+    if (item.type() == Value::Type::List && !item.asList().empty()) {
+        return item.asList()[0];
+    }
+    return item;
+}
+
+const Heap& heapArg(const std::vector<Value>& args, size_t count,
+                    const std::string& name) {
+    if (args.size() != count) {
+        throw std::runtime_error(name + " expects " + std::to_string(count) +
+                                 (count == 1 ? " arg" : " args"));
+    }
+    if (args[0].type() != Value::Type::Heap) {
+        throw std::runtime_error(name + " first arg must be a heap");
+    }
+    return args[0].asHeap();
+}
+
+// Checks the deque argument of the deque builtins and returns it.
+const Value::DequeType& dequeArg(const std::vector<Value>& args, size_t count,
+                                 const std::string& name) {
+    if (args.size() != count) {
+        throw std::runtime_error(name + " expects " + std::to_string(count) +
+                                 (count == 1 ? " arg" : " args"));
+    }
+    if (args[0].type() != Value::Type::Deque) {
+        throw std::runtime_error(name + " first arg must be a deque");
+    }
+    return args[0].asDeque();
+}
+
+// Where x goes in the sorted list of the (list, x) arguments: before the
+// elements equal to it, or after them when Right. Lists are ordered as by
+// compareKeys(); packed lists are searched in their buffer.
+template <bool Right>
+size_t bisect(const std::vector<Value>& args, const std::string& name) {
+    if (args.size() != 2) throw std::runtime_error(name + " expects 2 args");
+    auto lst = listArg(args, 0, name);
+    const Value& x = args[1];
+    if (x.type() != Value::Type::Number && x.type() != Value::Type::String) {
+        throw std::runtime_error(name + " expects a number or string");
+    }
+    double y;
+    if (lst.isPacked() && Value::packable(x, y)) {
+        auto xs = lst.numbers();
+        auto it = Right ? std::upper_bound(xs.begin(), xs.end(), y)
+                        : std::lower_bound(xs.begin(), xs.end(), y);
+        return it - xs.begin();
+    }
+    auto less = [](const Value& a, const Value& b) {
+        return compareKeys(a, b) < 0;
+    };
+    auto it = Right ? std::upper_bound(lst.begin(), lst.end(), x, less)
+                    : std::lower_bound(lst.begin(), lst.end(), x, less);
+    return it - lst.begin();
+}
+
+// Checks the set / map argument of the ordered container builtins, which
+// take count args, and returns it.
+const OrderedMap& orderedArg(const std::vector<Value>& args, size_t count,
+                             const std::string& name) {
+    if (args.size() != count) {
+        throw std::runtime_error(name + " expects " + std::to_string(count) +
+                                 " args");
+    }
+    if (args[0].type() != Value::Type::OrderedMap) {
+        throw std::runtime_error(name +
+                                 " first arg must be an ordered set or map");
+    }
+    return args[0].asOrderedMap();
+}
+
+}  // namespace
+
 void registerStandardLibrary(Environment::Builder& eb) {
     eb.addGlobal("print", Value::makeFunction(
                               [](auto const& args, Environment& env) -> Value {
@@ -71,27 +441,71 @@ void registerStandardLibrary(Environment::Builder& eb) {
         }));
 
     eb.addGlobal("range", Value::makeFunction([](auto const& args,
-                                                 Environment&) -> Value {
+                                                 Environment& env) -> Value {
                      if (args.size() != 3)
                          throw std::runtime_error("range expects 3 args");
-                     int a = static_cast<int>(args[0].asNumber());
-                     int b = static_cast<int>(args[1].asNumber());
-                     int step = static_cast<int>(args[2].asNumber());
+                     std::int64_t a = args[0].asInteger();
+                     std::int64_t b = args[1].asInteger();
+                     std::int64_t step = args[2].asInteger();
                      if (step == 0) throw std::runtime_error("range step zero");
-                     std::vector<Value> outList;
-                     for (int i = a; (step > 0 ? i < b : i > b); i += step) {
-                         outList.push_back(Value::makeNumber(i));
+                     auto generate = [&](auto& out, auto element) {
+                         if (step > 0 ? a < b : a > b) {
+                             auto span = step > 0 ? b - a : a - b;
+                             auto by = step > 0 ? step : -step;
+                             std::uint64_t n = (span - 1) / by + 1;
+                             env.checkAllocation(n, sizeof(out[0]));
+                             out.reserve(n);
+                         }
+                         for (auto i = a; (step > 0 ? i < b : i > b);
+                              i += step) {
+                             out.push_back(element(i));
+                         }
+                     };
+                     double lo, hi;
+                     if (Value::packable(Value::makeInteger(a), lo) &&
+                         Value::packable(Value::makeInteger(b), hi)) {
+                         Value::NumArray out;
+                         generate(out, [](std::int64_t i) {
+                             return static_cast<double>(i);
+                         });
+                         return Value::makeArray(std::move(out));
                      }
+                     std::vector<Value> outList;
+                     generate(outList, Value::makeInteger);
                      return Value::makeList(std::move(outList));
                  }));
 
+    eb.addGlobal("array", Value::makeFunction([](auto const& args,
+                                                 Environment&) -> Value {
+                     if (args.empty() || args.size() > 2)
+                         throw std::runtime_error("array expects 1 or 2 args");
+                     std::int64_t n = args[0].asInteger();
+                     if (n < 0) throw std::runtime_error("array size negative");
+                     Value fill =
+                         args.size() == 2 ? args[1] : Value::makeInteger(0);
+                     double x;
+                     if (!Value::packable(fill, x)) {
+                         if (fill.type() != Value::Type::Number)
+                             throw std::runtime_error("array fill must be a "
+                                                      "number");
+                         return Value::makeList(Value::ListType(n, fill));
+                     }
+                     return Value::makeArray(Value::NumArray(n, x));
+                 }));
+
     eb.addGlobal(
         "len", Value::makeFunction([](auto const& args, Environment&) -> Value {
             if (args.size() != 1) throw std::runtime_error("len expects 1 arg");
             if (args[0].type() == Value::Type::String) {
-                return Value::makeNumber(args[0].asString().size());
+                return Value::makeInteger(args[0].asString().size());
             } else if (args[0].type() == Value::Type::List) {
-                return Value::makeNumber(args[0].asList().size());
+                return Value::makeInteger(args[0].asList().size());
+            } else if (args[0].type() == Value::Type::Heap) {
+                return Value::makeInteger(args[0].asHeap().size());
+            } else if (args[0].type() == Value::Type::Deque) {
+                return Value::makeInteger(args[0].asDeque().size());
+            } else if (args[0].type() == Value::Type::OrderedMap) {
+                return Value::makeInteger(args[0].asOrderedMap().size());
             }
             throw std::runtime_error("len unsupported type");
         }));
@@ -99,6 +513,12 @@ void registerStandardLibrary(Environment::Builder& eb) {
     eb.addGlobal(
         "abs", Value::makeFunction([](auto const& args, Environment&) -> Value {
             if (args.size() != 1) throw std::runtime_error("abs expects 1 arg");
+            if (args[0].isInteger()) {
+                std::int64_t x = args[0].asInteger();
+                if (x != std::numeric_limits<std::int64_t>::min()) {
+                    return Value::makeInteger(x < 0 ? -x : x);
+                }
+            }
             double x = args[0].asNumber();
             return Value::makeNumber(std::fabs(x));
         }));
@@ -107,26 +527,42 @@ void registerStandardLibrary(Environment::Builder& eb) {
                                                 Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("ceil expects 1 arg");
-                     double x = args[0].asNumber();
-                     return Value::makeNumber(std::ceil(x));
+                     if (args[0].isInteger()) return args[0];
+                     return wholeNumber(std::ceil(args[0].asNumber()));
                  }));
 
     eb.addGlobal("floor", Value::makeFunction([](auto const& args,
                                                  Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("floor expects 1 arg");
-                     double x = args[0].asNumber();
-                     return Value::makeNumber(std::floor(x));
+                     if (args[0].isInteger()) return args[0];
+                     return wholeNumber(std::floor(args[0].asNumber()));
                  }));
 
     eb.addGlobal("round", Value::makeFunction([](auto const& args,
                                                  Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("round expects 1 arg");
-                     double x = args[0].asNumber();
-                     return Value::makeNumber(std::round(x));
+                     if (args[0].isInteger()) return args[0];
+                     return wholeNumber(std::round(args[0].asNumber()));
+                 }));
+
+    eb.addGlobal("popcount", Value::makeFunction([](auto const& args,
+                                                    Environment&) -> Value {
+                     return Value::makeInteger(
+                         std::popcount(bitsOf(args, "popcount")));
                  }));
 
+    eb.addGlobal(
+        "clz", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return Value::makeInteger(std::countl_zero(bitsOf(args, "clz")));
+        }));
+
+    eb.addGlobal(
+        "ctz", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return Value::makeInteger(std::countr_zero(bitsOf(args, "ctz")));
+        }));
+
     eb.addGlobal("sqrt", Value::makeFunction([](auto const& args,
                                                 Environment&) -> Value {
                      if (args.size() != 1)
@@ -139,19 +575,26 @@ void registerStandardLibrary(Environment::Builder& eb) {
     eb.addGlobal(
         "rnd", Value::makeFunction([](auto const& args, Environment&) -> Value {
             if (args.size() != 1) throw std::runtime_error("rnd expects 1 arg");
-            int n = static_cast<int>(args[0].asNumber());
+            std::int64_t n = args[0].asInteger();
             if (n <= 0) throw std::runtime_error("rnd argument must be > 0");
 
-            static std::mt19937_64 gen(std::random_device{}());
-            std::uniform_int_distribution<int> dist(0, n - 1);
-            return Value::makeNumber(dist(gen));
+            thread_local std::mt19937_64 gen(std::random_device{}());
+            std::uniform_int_distribution<std::int64_t> dist(0, n - 1);
+            return Value::makeInteger(dist(gen));
         }));
 
     eb.addGlobal("parse_num", Value::makeFunction([](auto const& args,
                                                      Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("parse_num expects 1 arg");
-                     const std::string& s = args[0].asString();
+                     std::string s(args[0].asString());
+                     std::int64_t i = 0;
+                     auto [ptr, ec] =
+                         std::from_chars(s.data(), s.data() + s.size(), i);
+                     if (!s.empty() && ec == std::errc() &&
+                         ptr == s.data() + s.size()) {
+                         return Value::makeInteger(i);
+                     }
                      try {
                          size_t idx = 0;
                          double d = std::stod(s, &idx);
@@ -167,6 +610,10 @@ void registerStandardLibrary(Environment::Builder& eb) {
                                                      Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("to_string expects 1 arg");
+                     if (args[0].isInteger()) {
+                         return Value::makeString(
+                             std::to_string(args[0].asInteger()));
+                     }
                      double x = args[0].asNumber();
                      if (std::floor(x) == x) {
                          return Value::makeString(
@@ -176,11 +623,11 @@ void registerStandardLibrary(Environment::Builder& eb) {
                      }
                  }));
 
-    eb.addGlobal("lower", Value::makeFunction([](auto const& args,
+    eb.addGlobal("lower", Value::makeFunction([](auto& args,
                                                  Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("lower expects 1 arg");
-                     std::string s = args[0].asString();
+                     std::string s = std::move(args[0].mutableString());
                      for (char& c : s) {
                          c = static_cast<char>(
                              std::tolower(static_cast<unsigned char>(c)));
@@ -188,11 +635,11 @@ void registerStandardLibrary(Environment::Builder& eb) {
                      return Value::makeString(std::move(s));
                  }));
 
-    eb.addGlobal("upper", Value::makeFunction([](auto const& args,
+    eb.addGlobal("upper", Value::makeFunction([](auto& args,
                                                  Environment&) -> Value {
                      if (args.size() != 1)
                          throw std::runtime_error("upper expects 1 arg");
-                     std::string s = args[0].asString();
+                     std::string s = std::move(args[0].mutableString());
                      for (char& c : s) {
                          c = static_cast<char>(
                              std::toupper(static_cast<unsigned char>(c)));
@@ -205,8 +652,8 @@ void registerStandardLibrary(Environment::Builder& eb) {
         Value::makeFunction([](auto const& args, Environment&) -> Value {
             if (args.size() != 2)
                 throw std::runtime_error("split expects 2 args");
-            const std::string& s = args[0].asString();
-            const std::string& delim = args[1].asString();
+            std::string_view s = args[0].asString();
+            std::string_view delim = args[1].asString();
             std::vector<Value> parts;
 
             if (delim.empty()) {
@@ -216,12 +663,13 @@ void registerStandardLibrary(Environment::Builder& eb) {
             } else {
                 size_t start = 0, pos;
                 while ((pos = s.find(delim, start)) != std::string::npos) {
-                    parts.push_back(
-                        Value::makeString(s.substr(start, pos - start)));
+                    parts.push_back(Value::makeString(
+                        std::string(s.substr(start, pos - start))));
                     start = pos + delim.size();
                 }
 
-                parts.push_back(Value::makeString(s.substr(start)));
+                parts.push_back(
+                    Value::makeString(std::string(s.substr(start))));
             }
             return Value::makeList(std::move(parts));
         }));
@@ -234,31 +682,36 @@ void registerStandardLibrary(Environment::Builder& eb) {
             const auto& lstVal = args[0];
             if (lstVal.type() != Value::Type::List)
                 throw std::runtime_error("join first arg must be a list");
-            const std::string& delim = args[1].asString();
+            std::string_view delim = args[1].asString();
 
-            const auto& listRef = lstVal.asList();
-            std::ostringstream oss;
-            for (size_t i = 0; i < listRef.size(); ++i) {
-                if (listRef[i].type() != Value::Type::String)
+            auto listRef = lstVal.asList();
+            size_t total = 0;
+            for (const auto& part : listRef) {
+                if (part.type() != Value::Type::String)
                     throw std::runtime_error(
                         "join only supports lists of strings");
-                oss << listRef[i].asString();
+                total += part.asString().size() + delim.size();
+            }
+            std::string out;
+            out.reserve(total);
+            for (size_t i = 0; i < listRef.size(); ++i) {
+                out += listRef[i].asString();
                 if (i + 1 < listRef.size()) {
-                    oss << delim;
+                    out += delim;
                 }
             }
-            return Value::makeString(oss.str());
+            return Value::makeString(std::move(out));
         }));
 
-    eb.addGlobal("replace", Value::makeFunction([](auto const& args,
+    eb.addGlobal("replace", Value::makeFunction([](auto& args,
                                                    Environment&) -> Value {
                      if (args.size() != 3)
                          throw std::runtime_error("replace expects 3 args");
-                     std::string s = args[0].asString();
-                     const std::string& oldSub = args[1].asString();
-                     const std::string& newSub = args[2].asString();
+                     std::string_view oldSub = args[1].asString();
+                     std::string_view newSub = args[2].asString();
+                     std::string s = std::move(args[0].mutableString());
                      if (oldSub.empty()) {
-                         return Value::makeString(s);
+                         return Value::makeString(std::move(s));
                      }
                      size_t pos = 0;
                      while ((pos = s.find(oldSub, pos)) != std::string::npos) {
@@ -270,14 +723,13 @@ void registerStandardLibrary(Environment::Builder& eb) {
 
     eb.addGlobal(
         "push",
-        Value::makeFunction([](auto const& args, Environment&) -> Value {
+        Value::makeFunction([](auto& args, Environment&) -> Value {
             if (args.size() != 2)
                 throw std::runtime_error("push expects 2 args");
             if (args[0].type() != Value::Type::List)
                 throw std::runtime_error("push first arg must be a list");
-            auto newList = args[0].asList();
-            newList.push_back(args[1]);
-            return Value::makeList(std::move(newList));
+            args[0].pushElement(std::move(args[1]));
+            return std::move(args[0]);
         }));
 
     eb.addGlobal(
@@ -285,45 +737,59 @@ void registerStandardLibrary(Environment::Builder& eb) {
             if (args.size() != 1) throw std::runtime_error("pop expects 1 arg");
             if (args[0].type() != Value::Type::List)
                 throw std::runtime_error("pop arg must be a list");
-            auto copyList = args[0].asList();
-            if (copyList.empty()) throw std::runtime_error("pop on empty list");
-            Value last = copyList.back();
-            return last;
+            auto lst = args[0].asList();
+            if (lst.empty()) throw std::runtime_error("pop on empty list");
+            return lst.back();
         }));
 
     eb.addGlobal(
         "insert",
-        Value::makeFunction([](auto const& args, Environment&) -> Value {
+        Value::makeFunction([](auto& args, Environment&) -> Value {
             if (args.size() != 3)
                 throw std::runtime_error("insert expects 3 args");
             if (args[0].type() != Value::Type::List)
                 throw std::runtime_error("insert first arg must be a list");
-            int idx = static_cast<int>(args[1].asNumber());
-            auto newList = args[0].asList();
-            if (idx < 0 || idx > static_cast<int>(newList.size()))
+            std::int64_t idx = args[1].asInteger();
+            if (idx < 0 ||
+                idx > static_cast<std::int64_t>(args[0].asList().size()))
                 throw std::runtime_error("insert index out of bounds");
-            newList.insert(newList.begin() + idx, args[2]);
-            return Value::makeList(std::move(newList));
+            args[0].insertElement(idx, std::move(args[2]));
+            return std::move(args[0]);
         }));
 
     eb.addGlobal(
         "remove",
-        Value::makeFunction([](auto const& args, Environment&) -> Value {
+        Value::makeFunction([](auto& args, Environment&) -> Value {
             if (args.size() != 2)
                 throw std::runtime_error("remove expects 2 args");
             if (args[0].type() != Value::Type::List)
                 throw std::runtime_error("remove first arg must be a list");
-            int idx = static_cast<int>(args[1].asNumber());
-            auto newList = args[0].asList();
-            if (idx < 0 || idx >= static_cast<int>(newList.size()))
+            std::int64_t idx = args[1].asInteger();
+            if (idx < 0 ||
+                idx >= static_cast<std::int64_t>(args[0].asList().size()))
                 throw std::runtime_error("remove index out of bounds");
-            newList.erase(newList.begin() + idx);
-            return Value::makeList(std::move(newList));
+            args[0].eraseElement(idx);
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "set_at",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            if (args.size() != 3)
+                throw std::runtime_error("set_at expects 3 args");
+            if (args[0].type() != Value::Type::List)
+                throw std::runtime_error("set_at first arg must be a list");
+            std::int64_t idx = args[1].asInteger();
+            if (idx < 0 ||
+                idx >= static_cast<std::int64_t>(args[0].asList().size()))
+                throw std::runtime_error("set_at index out of bounds");
+            args[0].setElement(idx, std::move(args[2]));
+            return std::move(args[0]);
         }));
 
     eb.addGlobal(
         "sort",
-        Value::makeFunction([](auto const& args, Environment& env) -> Value {
+        Value::makeFunction([](auto& args, Environment& env) -> Value {
             if (args.size() < 1 || args.size() > 2) {
                 throw std::runtime_error("sort expects 1 or 2 args");
             }
@@ -332,25 +798,44 @@ void registerStandardLibrary(Environment::Builder& eb) {
                 throw std::runtime_error("sort first arg must be a list");
             }
 
-            auto newList = args[0].asList();
+            auto newList = std::move(args[0].mutableList());
 
             if (args.size() == 1) {
-                std::stable_sort(newList.begin(), newList.end(),
-                                 [](const Value& a, const Value& b) {
-                                     return a.toString() < b.toString();
-                                 });
+                // Elements are ordered by their printed form; render each one
+                // once instead of twice per comparison.
+                KeyedOrder<std::string> order(newList.size());
+                auto render = [&](size_t from, size_t to) {
+                    for (size_t i = from; i < to; ++i) {
+                        order[i] = {newList[i].toString(), i};
+                    }
+                };
+                ThreadPool* pool = order.size() >= kParallelSortThreshold
+                                       ? env.pool()
+                                       : nullptr;
+                if (pool) {
+                    size_t n = order.size(), parts = pool->size();
+                    pool->run(parts, [&](size_t i) {
+                        render(i * n / parts, (i + 1) * n / parts);
+                    });
+                } else {
+                    render(0, order.size());
+                }
+                sortOrder(order, env);
+                return Value::makeList(permuted(newList, order));
             } else {
                 if (args[1].type() != Value::Type::Function) {
                     throw std::runtime_error(
                         "sort second arg must be a function");
                 }
 
-                auto cmpFunc = args[1].asFunction();
+                const auto& cmpFunc = args[1].asFunction();
+                std::vector<Value> cmpArgs(2);
 
                 std::stable_sort(
                     newList.begin(), newList.end(),
                     [&](const Value& a, const Value& b) {
-                        Value result = cmpFunc({a, b}, env);
+                        cmpArgs.assign({a, b});
+                        Value result = cmpFunc(cmpArgs, env);
                         if (result.type() != Value::Type::Boolean) {
                             throw std::runtime_error(
                                 "sort comparator must return boolean");
@@ -361,6 +846,527 @@ void registerStandardLibrary(Environment::Builder& eb) {
 
             return Value::makeList(std::move(newList));
         }));
+
+    eb.addGlobal(
+        "sort_by",
+        Value::makeFunction([](auto& args, Environment& env) -> Value {
+            if (args.size() != 2) {
+                throw std::runtime_error("sort_by expects 2 args");
+            }
+            if (args[0].type() != Value::Type::List) {
+                throw std::runtime_error("sort_by first arg must be a list");
+            }
+            if (args[1].type() != Value::Type::Function) {
+                throw std::runtime_error(
+                    "sort_by second arg must be a function");
+            }
+
+            // The key function runs once per element, in list order, before
+            // anything is reordered.
+            const auto& keyFunc = args[1].asFunction();
+            auto lst = args[0].asList();
+            std::vector<Value> keys;
+            keys.reserve(lst.size());
+            std::vector<Value> keyArgs(1);
+            for (const auto& v : lst) {
+                keyArgs.assign(1, v);
+                keys.push_back(keyFunc(keyArgs, env));
+            }
+
+            // sortByKeys checks the keys before it moves any element.
+            return Value::makeList(
+                sortByKeys(args[0].mutableList(), keys, env));
+        }));
+
+    // Higher-order builtins call the script function with one argument
+    // buffer that is refilled per element; a function call moves its
+    // arguments into its frame, so the slots are reassigned every time.
+    eb.addGlobal(
+        "map", Value::makeFunction([](auto& args, Environment& env) -> Value {
+            expectListAndFunction(args, 2, 2, "map");
+            auto lst = args[0].asList();
+            Value::ListType out(lst.size());
+            mapRange(lst, args[1].asFunction(), env, out, 0, lst.size());
+            return Value::makeList(std::move(out));
+        }));
+
+    // Runs chunks of the list on the thread pool, each in a forked
+    // environment. Script values are immutable to their readers, so the
+    // only way a worker can be observed is through I/O; a worker that
+    // attempts it fails with IsolationError, and the whole map is then
+    // redone sequentially so output and errors match map exactly.
+    eb.addGlobal("parallel_map", Value::makeFunction([](auto& args,
+                                                        Environment& env)
+                                                         -> Value {
+                     expectListAndFunction(args, 2, 2, "parallel_map");
+                     const auto& fn = args[1].asFunction();
+                     auto lst = args[0].asList();
+                     size_t n = lst.size();
+                     Value::ListType out(n);
+
+                     ThreadPool* pool = n > 1 ? env.pool() : nullptr;
+                     if (!pool) {
+                         mapRange(lst, fn, env, out, 0, n);
+                         return Value::makeList(std::move(out));
+                     }
+
+                     size_t parts = std::min(n, pool->size() * 4);
+                     std::vector<std::exception_ptr> errors(parts);
+                     pool->run(parts, [&](size_t p) {
+                         try {
+                             auto worker = env.fork();
+                             mapRange(lst, fn, *worker, out, p * n / parts,
+                                      (p + 1) * n / parts);
+                         } catch (...) {
+                             errors[p] = std::current_exception();
+                         }
+                     });
+                     env.joinForks();
+
+                     // The first failing chunk holds the lowest failing
+                     // element, which is where map would have stopped.
+                     auto failed = std::find_if(
+                         errors.begin(), errors.end(),
+                         [](const auto& e) { return e != nullptr; });
+                     if (failed != errors.end()) {
+                         try {
+                             std::rethrow_exception(*failed);
+                         } catch (const IsolationError&) {
+                             mapRange(lst, fn, env, out, 0, n);
+                         }
+                     }
+                     return Value::makeList(std::move(out));
+                 }));
+
+    eb.addGlobal("filter", Value::makeFunction([](auto& args,
+                                                  Environment& env) -> Value {
+                     expectListAndFunction(args, 2, 2, "filter");
+                     const auto& pred = args[1].asFunction();
+                     auto lst = args[0].asList();
+                     Value::ListType out;
+                     out.reserve(lst.size());
+                     std::vector<Value> callArgs(1);
+                     for (const auto& v : lst) {
+                         callArgs[0] = v;
+                         if (test(pred, callArgs, env, "filter")) {
+                             out.push_back(v);
+                         }
+                     }
+                     return Value::makeList(std::move(out));
+                 }));
+
+    eb.addGlobal("reduce", Value::makeFunction([](auto& args,
+                                                  Environment& env) -> Value {
+                     expectListAndFunction(args, 2, 3, "reduce");
+                     const auto& fn = args[1].asFunction();
+                     auto lst = args[0].asList();
+                     size_t i = 0;
+                     Value acc;
+                     if (args.size() == 3) {
+                         acc = std::move(args[2]);
+                     } else if (lst.empty()) {
+                         throw std::runtime_error(
+                             "reduce of empty list with no initial value");
+                     } else {
+                         acc = lst[i++];
+                     }
+                     std::vector<Value> callArgs(2);
+                     for (; i < lst.size(); ++i) {
+                         callArgs[0] = std::move(acc);
+                         callArgs[1] = lst[i];
+                         acc = fn(callArgs, env);
+                     }
+                     return acc;
+                 }));
+
+    eb.addGlobal(
+        "any", Value::makeFunction([](auto& args, Environment& env) -> Value {
+            expectListAndFunction(args, 2, 2, "any");
+            const auto& pred = args[1].asFunction();
+            std::vector<Value> callArgs(1);
+            for (const auto& v : args[0].asList()) {
+                callArgs[0] = v;
+                if (test(pred, callArgs, env, "any")) {
+                    return Value::makeBoolean(true);
+                }
+            }
+            return Value::makeBoolean(false);
+        }));
+
+    eb.addGlobal(
+        "all", Value::makeFunction([](auto& args, Environment& env) -> Value {
+            expectListAndFunction(args, 2, 2, "all");
+            const auto& pred = args[1].asFunction();
+            std::vector<Value> callArgs(1);
+            for (const auto& v : args[0].asList()) {
+                callArgs[0] = v;
+                if (!test(pred, callArgs, env, "all")) {
+                    return Value::makeBoolean(false);
+                }
+            }
+            return Value::makeBoolean(true);
+        }));
+
+    eb.addGlobal("enumerate", Value::makeFunction([](auto const& args,
+                                                     Environment&) -> Value {
+                     if (args.size() != 1 ||
+                         args[0].type() != Value::Type::List) {
+                         throw std::runtime_error("enumerate expects a list");
+                     }
+                     auto lst = args[0].asList();
+                     Value::ListType out;
+                     out.reserve(lst.size());
+                     for (size_t i = 0; i < lst.size(); ++i) {
+                         out.push_back(Value::makeList(
+                             {Value::makeInteger(i), lst[i]}));
+                     }
+                     return Value::makeList(std::move(out));
+                 }));
+
+    eb.addGlobal(
+        "sum", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            if (args.size() != 1) throw std::runtime_error("sum expects 1 arg");
+            auto lst = listArg(args, 0, "sum");
+            if (expectNumbers(lst, "sum")) {
+                std::int64_t total = 0;
+                bool exact = true;
+                for (size_t i = 0; exact && i < lst.size(); ++i) {
+                    exact = !addOverflow(total, lst[i].asInteger(), total);
+                }
+                if (exact) return Value::makeInteger(total);
+            }
+            std::vector<double> scratch;
+            return Value::makeNumber(kernels::sum(doublesOf(lst, scratch)));
+        }));
+
+    eb.addGlobal(
+        "min", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return extremeOf<false>(args, "min");
+        }));
+
+    eb.addGlobal(
+        "max", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return extremeOf<true>(args, "max");
+        }));
+
+    eb.addGlobal("argmin", Value::makeFunction([](auto const& args,
+                                                  Environment&) -> Value {
+                     if (args.size() != 1)
+                         throw std::runtime_error("argmin expects 1 arg");
+                     return Value::makeInteger(extremeIndex<false>(
+                         listArg(args, 0, "argmin"), "argmin"));
+                 }));
+
+    eb.addGlobal("argmax", Value::makeFunction([](auto const& args,
+                                                  Environment&) -> Value {
+                     if (args.size() != 1)
+                         throw std::runtime_error("argmax expects 1 arg");
+                     return Value::makeInteger(extremeIndex<true>(
+                         listArg(args, 0, "argmax"), "argmax"));
+                 }));
+
+    eb.addGlobal(
+        "dot", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            if (args.size() != 2) {
+                throw std::runtime_error("dot expects 2 args");
+            }
+            auto a = listArg(args, 0, "dot");
+            auto b = listArg(args, 1, "dot");
+            if (a.size() != b.size()) {
+                throw std::runtime_error("dot lists differ in length");
+            }
+            bool ints = expectNumbers(a, "dot");
+            if (expectNumbers(b, "dot") && ints) {
+                std::int64_t total = 0;
+                bool exact = true;
+                for (size_t i = 0; exact && i < a.size(); ++i) {
+                    std::int64_t p;
+                    exact = !mulOverflow(a[i].asInteger(), b[i].asInteger(),
+                                         p) &&
+                            !addOverflow(total, p, total);
+                }
+                if (exact) return Value::makeInteger(total);
+            }
+            std::vector<double> aScratch, bScratch;
+            return Value::makeNumber(kernels::dot(doublesOf(a, aScratch),
+                                                  doublesOf(b, bScratch)));
+        }));
+
+    eb.addGlobal("cumsum", Value::makeFunction([](auto const& args,
+                                                  Environment&) -> Value {
+                     if (args.size() != 1)
+                         throw std::runtime_error("cumsum expects 1 arg");
+                     auto lst = listArg(args, 0, "cumsum");
+                     expectNumbers(lst, "cumsum");
+                     // Running totals are exact until the first double or
+                     // overflow, like a loop of + would be.
+                     Value::ListType out;
+                     out.reserve(lst.size());
+                     std::int64_t exactTotal = 0;
+                     double total = 0;
+                     bool exact = true;
+                     for (const auto& v : lst) {
+                         std::int64_t next;
+                         if (exact && v.isInteger() &&
+                             !addOverflow(exactTotal, v.asInteger(), next)) {
+                             exactTotal = next;
+                             out.push_back(Value::makeInteger(exactTotal));
+                             continue;
+                         }
+                         if (exact) total = static_cast<double>(exactTotal);
+                         exact = false;
+                         total += v.asNumber();
+                         out.push_back(Value::makeNumber(total));
+                     }
+                     return Value::makeList(std::move(out));
+                 }));
+
+    eb.addGlobal(
+        "add", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return elementwise<false>(args, "add");
+        }));
+
+    eb.addGlobal(
+        "mul", Value::makeFunction([](auto const& args, Environment&) -> Value {
+            return elementwise<true>(args, "mul");
+        }));
+
+    eb.addGlobal(
+        "heap",
+        Value::makeFunction([](auto const& args, Environment& env) -> Value {
+            // heap(), heap(items), heap(key) or heap(items, key).
+            const Value* items = nullptr;
+            Value keyFn;
+            for (const auto& a : args) {
+                if (a.type() == Value::Type::List && !items) {
+                    items = &a;
+                } else if (a.type() == Value::Type::Function &&
+                           keyFn.type() == Value::Type::Nil) {
+                    keyFn = a;
+                } else {
+                    throw std::runtime_error(
+                        "heap expects a list and/or a key function");
+                }
+            }
+            Heap h(std::move(keyFn));
+            if (items) {
+                for (Value item : items->asList()) {
+                    Value key = heapKey(h, item, env);
+                    h.push(std::move(item), std::move(key));
+                }
+            }
+            return Value::makeHeap(std::move(h));
+        }));
+
+    eb.addGlobal(
+        "heap_push",
+        Value::makeFunction([](auto& args, Environment& env) -> Value {
+            Value key = heapKey(heapArg(args, 2, "heap_push"), args[1], env);
+            args[0].mutableHeap().push(std::move(args[1]), std::move(key));
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal("heap_pop", Value::makeFunction([](auto& args,
+                                                    Environment&) -> Value {
+                     if (heapArg(args, 1, "heap_pop").empty())
+                         throw std::runtime_error("heap_pop on empty heap");
+                     args[0].mutableHeap().pop();
+                     return std::move(args[0]);
+                 }));
+
+    eb.addGlobal("heap_top", Value::makeFunction([](auto const& args,
+                                                    Environment&) -> Value {
+                     const Heap& h = heapArg(args, 1, "heap_top");
+                     if (h.empty())
+                         throw std::runtime_error("heap_top on empty heap");
+                     return h.top();
+                 }));
+
+    eb.addGlobal("deque", Value::makeFunction([](auto const& args,
+                                                 Environment&) -> Value {
+                     if (args.empty()) return Value::makeDeque({});
+                     if (args.size() != 1 ||
+                         args[0].type() != Value::Type::List) {
+                         throw std::runtime_error("deque expects a list");
+                     }
+                     auto lst = args[0].asList();
+                     return Value::makeDeque({lst.begin(), lst.end()});
+                 }));
+
+    eb.addGlobal(
+        "push_back",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            dequeArg(args, 2, "push_back");
+            args[0].mutableDeque().push_back(std::move(args[1]));
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "push_front",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            dequeArg(args, 2, "push_front");
+            args[0].mutableDeque().push_front(std::move(args[1]));
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "pop_back", Value::makeFunction([](auto& args, Environment&) -> Value {
+            if (dequeArg(args, 1, "pop_back").empty())
+                throw std::runtime_error("pop_back on empty deque");
+            args[0].mutableDeque().pop_back();
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "pop_front",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            if (dequeArg(args, 1, "pop_front").empty())
+                throw std::runtime_error("pop_front on empty deque");
+            args[0].mutableDeque().pop_front();
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal("bisect_left", Value::makeFunction([](auto const& args,
+                                                       Environment&) -> Value {
+                     return Value::makeInteger(
+                         bisect<false>(args, "bisect_left"));
+                 }));
+
+    eb.addGlobal("bisect_right", Value::makeFunction([](auto const& args,
+                                                        Environment&) -> Value {
+                     return Value::makeInteger(
+                         bisect<true>(args, "bisect_right"));
+                 }));
+
+    eb.addGlobal(
+        "sorted_insert",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            size_t i = bisect<true>(args, "sorted_insert");
+            args[0].insertElement(i, std::move(args[1]));
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "ordered_set",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            if (args.size() > 1) {
+                throw std::runtime_error("ordered_set expects 0 or 1 args");
+            }
+            OrderedMap s(true);
+            if (!args.empty()) {
+                for (Value key : listArg(args, 0, "ordered_set")) {
+                    s.insert(std::move(key), Value());
+                }
+            }
+            return Value::makeOrderedMap(std::move(s));
+        }));
+
+    eb.addGlobal(
+        "ordered_map",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            if (args.size() > 1) {
+                throw std::runtime_error("ordered_map expects 0 or 1 args");
+            }
+            OrderedMap m(false);
+            if (!args.empty()) {
+                for (Value pair : listArg(args, 0, "ordered_map")) {
+                    if (pair.type() != Value::Type::List ||
+                        pair.asList().size() != 2) {
+                        throw std::runtime_error(
+                            "ordered_map expects [key, value] pairs");
+                    }
+                    auto kv = pair.asList();
+                    m.insert(kv[0], kv[1]);
+                }
+            }
+            return Value::makeOrderedMap(std::move(m));
+        }));
+
+    eb.addGlobal(
+        "ordered_insert",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            if (args.size() == 2 || args.size() == 3) {
+                // Sets take a key; maps a key and a value.
+                bool isSet =
+                    orderedArg(args, args.size(), "ordered_insert").isSet();
+                if (isSet == (args.size() == 2)) {
+                    Value value = isSet ? Value() : std::move(args[2]);
+                    args[0].mutableOrderedMap().insert(std::move(args[1]),
+                                                       std::move(value));
+                    return std::move(args[0]);
+                }
+            }
+            throw std::runtime_error(
+                "ordered_insert expects (set, key) or (map, key, value)");
+        }));
+
+    eb.addGlobal(
+        "ordered_erase",
+        Value::makeFunction([](auto& args, Environment&) -> Value {
+            orderedArg(args, 2, "ordered_erase");
+            args[0].mutableOrderedMap().erase(args[1]);
+            return std::move(args[0]);
+        }));
+
+    eb.addGlobal(
+        "ordered_contains",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            const OrderedMap& m = orderedArg(args, 2, "ordered_contains");
+            return Value::makeBoolean(m.find(args[1]) != nullptr);
+        }));
+
+    eb.addGlobal(
+        "ordered_get",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            const OrderedMap& m = orderedArg(args, 2, "ordered_get");
+            if (m.isSet()) {
+                throw std::runtime_error("ordered_get expects an ordered map");
+            }
+            const auto* e = m.find(args[1]);
+            return e ? e->value : Value::makeNil();
+        }));
+
+    eb.addGlobal(
+        "ordered_rank",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            const OrderedMap& m = orderedArg(args, 2, "ordered_rank");
+            return Value::makeInteger(m.rank(args[1]));
+        }));
+
+    eb.addGlobal(
+        "ordered_at",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            const OrderedMap& m = orderedArg(args, 2, "ordered_at");
+            std::int64_t i = args[1].asInteger();
+            if (i < 0 || i >= static_cast<std::int64_t>(m.size()))
+                throw std::runtime_error("ordered_at index out of bounds");
+            return m.element(m.at(i));
+        }));
+
+    eb.addGlobal(
+        "ordered_lower_bound",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            const OrderedMap& m =
+                orderedArg(args, 2, "ordered_lower_bound");
+            size_t i = m.rank(args[1]);
+            return i < m.size() ? m.element(m.at(i)) : Value::makeNil();
+        }));
+
+    // Interpreter counters since the process started, as an ordered map
+    // from counter name to count; see stats.h.
+    eb.addGlobal(
+        "stats",
+        Value::makeFunction([](auto const& args, Environment&) -> Value {
+            if (!args.empty()) throw std::runtime_error("stats expects 0 args");
+            stats::Snapshot counts = stats::read();
+            OrderedMap m(false);
+            for (size_t i = 0; i < stats::kCounters; ++i) {
+                auto c = static_cast<stats::Counter>(i);
+                m.insert(Value::makeString(std::string(stats::name(c))),
+                         Value::makeInteger(counts[i]));
+            }
+            return Value::makeOrderedMap(std::move(m));
+        }));
 }
 
 }  // namespace itmoscript
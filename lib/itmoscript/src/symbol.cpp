@@ -0,0 +1,39 @@
+#include "itmoscript/symbol.h"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace itmoscript {
+
+Symbol::Symbol(std::string_view name) {
+    // Keys view the names owned by the entries. The table is never
+    // destroyed, so symbols stay valid during static destruction too.
+    using Table = std::unordered_map<std::string_view, std::unique_ptr<Entry>>;
+    static std::shared_mutex mutex;
+    static Table& table = *new Table;
+
+    {
+        std::shared_lock lock(mutex);
+        auto found = table.find(name);
+        if (found != table.end()) {
+            entry_ = found->second.get();
+            return;
+        }
+    }
+    std::unique_lock lock(mutex);
+    auto found = table.find(name);
+    if (found == table.end()) {
+        std::string owned(name);
+        size_t hash = std::hash<std::string_view>{}(owned);
+        Value value = Value::makeString(owned);
+        auto entry = std::unique_ptr<Entry>(
+            new Entry{std::move(owned), hash, std::move(value)});
+        found = table.emplace(entry->name, std::move(entry)).first;
+    }
+    entry_ = found->second.get();
+}
+
+}  // namespace itmoscript
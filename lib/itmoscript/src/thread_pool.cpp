@@ -0,0 +1,84 @@
+#include "itmoscript/thread_pool.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace itmoscript {
+
+ThreadPool::ThreadPool(size_t size) {
+    for (size_t i = 1; i < size; ++i) {
+        threads_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::run(size_t n, const std::function<void(size_t)>& task) {
+    if (n == 0) return;
+
+    // Indices are claimed from a shared counter, so a helper that starts
+    // late finds nothing left and never touches task after run() returned.
+    struct Batch {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto batch = std::make_shared<Batch>();
+
+    auto work = [batch, &task, n] {
+        for (size_t i; (i = batch->next.fetch_add(1)) < n;) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard lock(batch->mutex);
+                if (!batch->error) batch->error = std::current_exception();
+            }
+            if (batch->done.fetch_add(1) + 1 == n) {
+                std::lock_guard lock(batch->mutex);
+                batch->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(threads_.size(), n - 1);
+    if (helpers > 0) {
+        {
+            std::lock_guard lock(mutex_);
+            for (size_t i = 0; i < helpers; ++i) queue_.emplace_back(work);
+        }
+        wake_.notify_all();
+    }
+
+    work();
+
+    std::unique_lock lock(batch->mutex);
+    batch->finished.wait(lock, [&] { return batch->done.load() == n; });
+    if (batch->error) std::rethrow_exception(batch->error);
+}
+
+}  // namespace itmoscript
@@ -0,0 +1,115 @@
+#include "itmoscript/tracer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string_view>
+
+namespace itmoscript {
+
+namespace {
+
+std::atomic<std::uint64_t> nextTracerId{1};
+
+// The buffer this thread last used, and the tracer it belongs to. Tracer
+// ids are never reused, so a stale entry is never mistaken for a live one.
+struct LocalBuffer {
+    std::uint64_t tracer = 0;
+    void* buffer = nullptr;
+};
+thread_local LocalBuffer localBuffer;
+
+void writeString(std::ostream& os, std::string_view s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\u%04x", c);
+            os << buf;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+// Microseconds, the unit of trace-event timestamps, to the nanosecond.
+void writeMicros(std::ostream& os, std::chrono::steady_clock::duration d) {
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.3f",
+                  std::chrono::duration<double, std::micro>(d).count());
+    os << buf;
+}
+
+}  // namespace
+
+Tracer::Tracer(std::chrono::nanoseconds minDuration)
+    : id_(nextTracerId.fetch_add(1, std::memory_order_relaxed)),
+      minDuration_(std::chrono::duration_cast<Clock::duration>(minDuration)),
+      epoch_(Clock::now()) {}
+
+Tracer::~Tracer() = default;
+
+Tracer::Buffer& Tracer::local() {
+    if (localBuffer.tracer == id_) {
+        return *static_cast<Buffer*>(localBuffer.buffer);
+    }
+    std::lock_guard lock(mutex_);
+    auto buffer = std::make_unique<Buffer>();
+    buffer->thread = static_cast<std::uint32_t>(buffers_.size()) + 1;
+    localBuffer = {id_, buffer.get()};
+    buffers_.push_back(std::move(buffer));
+    return *buffers_.back();
+}
+
+void Tracer::enter(Symbol name, bool builtin) {
+    local().open.push_back({name, builtin, Clock::now(), {}});
+}
+
+void Tracer::exit() {
+    auto now = Clock::now();
+    Buffer& b = local();
+    if (b.open.empty()) return;
+    Event e = b.open.back();
+    b.open.pop_back();
+    e.length = now - e.start;
+    if (e.length >= minDuration_) b.done.push_back(e);
+}
+
+size_t Tracer::events() const {
+    std::lock_guard lock(mutex_);
+    size_t n = 0;
+    for (const auto& b : buffers_) n += b->done.size();
+    return n;
+}
+
+void Tracer::writeJson(std::ostream& os) const {
+    std::lock_guard lock(mutex_);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separate = [&] {
+        os << (first ? "\n" : ",\n");
+        first = false;
+    };
+    for (const auto& b : buffers_) {
+        separate();
+        os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << b->thread << ",\"args\":{\"name\":\""
+           << (b->thread == 1 ? "interpreter" : "worker") << "\"}}";
+        for (const Event& e : b->done) {
+            separate();
+            os << "{\"name\":";
+            writeString(os, e.name.str());
+            os << ",\"cat\":\"" << (e.builtin ? "builtin" : "script")
+               << "\",\"ph\":\"X\",\"ts\":";
+            writeMicros(os, e.start - epoch_);
+            os << ",\"dur\":";
+            writeMicros(os, e.length);
+            os << ",\"pid\":1,\"tid\":" << b->thread << "}";
+        }
+    }
+    os << "\n]}\n";
+}
+
+}  // namespace itmoscript
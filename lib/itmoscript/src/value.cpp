@@ -1,31 +1,114 @@
 
 #include "itmoscript/value.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <span>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "itmoscript/heap.h"
+#include "itmoscript/ordered_map.h"
+#include "itmoscript/stats.h"
 
 namespace itmoscript {
 
+namespace {
+
+// Allocates a string or list buffer, counting it in the stats.
+template <typename T, typename... Args>
+std::shared_ptr<T> newBuffer(Args&&... args) {
+    auto buf = std::make_shared<T>(std::forward<Args>(args)...);
+    stats::add(std::is_same_v<T, std::string> ? stats::Counter::StringBuffers
+                                              : stats::Counter::ListBuffers);
+    stats::add(stats::Counter::BufferBytes,
+               buf->capacity() * sizeof(typename T::value_type));
+    return buf;
+}
+
+}  // namespace
+
 Value::Value() noexcept : type_(Type::Nil), data_(std::monostate{}) {}
 
 Value::Value(double x) : type_(Type::Number), data_(x) {}
 
-Value::Value(const std::string& s) : type_(Type::String), data_(s) {}
+Value::Value(std::int64_t x) : type_(Type::Number), data_(x) {}
+
+Value::Value(std::string s)
+    : type_(Type::String),
+      data_(Shared<std::string>{newBuffer<std::string>(std::move(s))}) {}
 
 Value::Value(bool b) : type_(Type::Boolean), data_(b) {}
 
-Value::Value(ListType v) : type_(Type::List), data_(std::move(v)) {}
+Value::Value(ListType v) : type_(Type::List) {
+    double x;
+    bool numeric = std::all_of(v.begin(), v.end(), [&](const Value& e) {
+        return packable(e, x);
+    });
+    if (!numeric) {
+        data_ = Shared<ListType>{newBuffer<ListType>(std::move(v))};
+        return;
+    }
+    NumArray packed(v.size());
+    for (size_t i = 0; i < v.size(); ++i) packable(v[i], packed[i]);
+    data_ = Shared<NumArray>{newBuffer<NumArray>(std::move(packed))};
+}
+
+Value::Value(NumArray v)
+    : type_(Type::List),
+      data_(Shared<NumArray>{newBuffer<NumArray>(std::move(v))}) {}
 
-Value::Value(FuncType f) : type_(Type::Function), data_(std::move(f)) {}
+Value::Value(PersistentList v) : type_(Type::List), data_(std::move(v)) {}
+
+Value::Value(FuncType f)
+    : type_(Type::Function),
+      data_(std::make_shared<const FuncType>(std::move(f))) {}
+
+Value Value::makeHeap(Heap h) {
+    Value v;
+    v.type_ = Type::Heap;
+    v.data_ = std::make_shared<Heap>(std::move(h));
+    return v;
+}
+
+Value Value::makeDeque(DequeType d) {
+    Value v;
+    v.type_ = Type::Deque;
+    v.data_ = std::make_shared<DequeType>(std::move(d));
+    return v;
+}
+
+Value Value::makeOrderedMap(OrderedMap m) {
+    Value v;
+    v.type_ = Type::OrderedMap;
+    v.data_ = std::make_shared<OrderedMap>(std::move(m));
+    return v;
+}
 
 double Value::asNumber() const {
     if (type_ != Type::Number) throw std::runtime_error("Not a number");
+    if (isInteger()) return static_cast<double>(std::get<std::int64_t>(data_));
     return std::get<double>(data_);
 }
 
-const std::string& Value::asString() const {
+std::int64_t Value::asInteger() const {
+    if (type_ != Type::Number) throw std::runtime_error("Not a number");
+    if (isInteger()) return std::get<std::int64_t>(data_);
+    double d = std::get<double>(data_);
+    // 2^63 is exactly representable; anything at or beyond it does not fit.
+    if (!(std::fabs(d) < 9223372036854775808.0))
+        throw std::runtime_error("Number out of integer range");
+    return static_cast<std::int64_t>(d);
+}
+
+std::string_view Value::asString() const {
     if (type_ != Type::String) throw std::runtime_error("Not a string");
-    return std::get<std::string>(data_);
+    const auto& d = std::get<Shared<std::string>>(data_);
+    std::string_view s = *d.buf;
+    return d.len == std::string::npos ? s : s.substr(d.off, d.len);
 }
 
 bool Value::asBoolean() const {
@@ -33,46 +116,298 @@ bool Value::asBoolean() const {
     return std::get<bool>(data_);
 }
 
-const Value::ListType& Value::asList() const {
+Value::ListView Value::asList() const {
     if (type_ != Type::List) throw std::runtime_error("Not a list");
-    return std::get<ListType>(data_);
+    auto window = [](const auto& d) {
+        std::span v(*d.buf);
+        return d.len == std::string::npos ? v : v.subspan(d.off, d.len);
+    };
+    if (isPacked()) return ListView(window(std::get<Shared<NumArray>>(data_)));
+    if (isPersistent()) return ListView(std::get<PersistentList>(data_));
+    return ListView(window(std::get<Shared<ListType>>(data_)));
 }
 
 const Value::FuncType& Value::asFunction() const {
     if (type_ != Type::Function) throw std::runtime_error("Not a function");
-    return std::get<FuncType>(data_);
+    return *std::get<std::shared_ptr<const FuncType>>(data_);
+}
+
+const Heap& Value::asHeap() const {
+    if (type_ != Type::Heap) throw std::runtime_error("Not a heap");
+    return *std::get<std::shared_ptr<Heap>>(data_);
+}
+
+const Value::DequeType& Value::asDeque() const {
+    if (type_ != Type::Deque) throw std::runtime_error("Not a deque");
+    return *std::get<std::shared_ptr<DequeType>>(data_);
+}
+
+const OrderedMap& Value::asOrderedMap() const {
+    if (type_ != Type::OrderedMap) {
+        throw std::runtime_error("Not an ordered set or map");
+    }
+    return *std::get<std::shared_ptr<OrderedMap>>(data_);
+}
+
+template <typename T>
+T& Value::unshare(Shared<T>& d) {
+    if (d.buf.use_count() == 1) {
+        if (d.len != std::string::npos) {
+            d.buf->erase(d.buf->begin() + d.off + d.len, d.buf->end());
+            d.buf->erase(d.buf->begin(), d.buf->begin() + d.off);
+        }
+    } else {
+        auto first = d.buf->begin() + d.off;
+        auto last = d.len == std::string::npos ? d.buf->end() : first + d.len;
+        d.buf = newBuffer<T>(first, last);
+    }
+    d.off = 0;
+    d.len = std::string::npos;
+    return *d.buf;
+}
+
+std::string& Value::mutableString() {
+    if (type_ != Type::String) throw std::runtime_error("Not a string");
+    return unshare(std::get<Shared<std::string>>(data_));
+}
+
+Value::ListType& Value::mutableList() {
+    if (type_ != Type::List) throw std::runtime_error("Not a list");
+    if (isPacked() || isPersistent()) flatten();
+    return unshare(std::get<Shared<ListType>>(data_));
+}
+
+Value::NumArray& Value::mutableNumbers() {
+    if (!isPacked()) throw std::runtime_error("Not a packed list");
+    return unshare(std::get<Shared<NumArray>>(data_));
+}
+
+Heap& Value::mutableHeap() {
+    if (type_ != Type::Heap) throw std::runtime_error("Not a heap");
+    auto& h = std::get<std::shared_ptr<Heap>>(data_);
+    if (h.use_count() != 1) h = std::make_shared<Heap>(*h);
+    return *h;
+}
+
+Value::DequeType& Value::mutableDeque() {
+    if (type_ != Type::Deque) throw std::runtime_error("Not a deque");
+    auto& d = std::get<std::shared_ptr<DequeType>>(data_);
+    if (d.use_count() != 1) d = std::make_shared<DequeType>(*d);
+    return *d;
+}
+
+OrderedMap& Value::mutableOrderedMap() {
+    if (type_ != Type::OrderedMap) {
+        throw std::runtime_error("Not an ordered set or map");
+    }
+    auto& m = std::get<std::shared_ptr<OrderedMap>>(data_);
+    if (m.use_count() != 1) m = std::make_shared<OrderedMap>(*m);
+    return *m;
 }
 
+void Value::flatten() {
+    auto lst = asList();
+    auto values = newBuffer<ListType>(lst.begin(), lst.end());
+    data_ = Shared<ListType>{std::move(values)};
+}
+
+namespace {
+
+// Shared flat lists shorter than this are simply copied on update.
+constexpr size_t kPersistentMinSize = 64;
+
+}  // namespace
+
+bool Value::updatesPersistently() {
+    if (type_ != Type::List) throw std::runtime_error("Not a list");
+    if (isPersistent()) return true;
+    if (isPacked()) return false;
+    auto& d = std::get<Shared<ListType>>(data_);
+    if (d.buf.use_count() == 1) return false;
+    auto lst = asList().values();
+    if (lst.size() < kPersistentMinSize) return false;
+    data_ = PersistentList(lst.begin(), lst.end());
+    return true;
+}
+
+void Value::pushElement(Value v) {
+    double x;
+    if (isPacked() && packable(v, x)) {
+        mutableNumbers().push_back(x);
+    } else if (updatesPersistently()) {
+        std::get<PersistentList>(data_).append(std::move(v));
+    } else {
+        mutableList().push_back(std::move(v));
+    }
+}
+
+void Value::insertElement(size_t i, Value v) {
+    double x;
+    if (isPacked() && packable(v, x)) {
+        auto& lst = mutableNumbers();
+        lst.insert(lst.begin() + i, x);
+    } else if (updatesPersistently()) {
+        auto& tree = std::get<PersistentList>(data_);
+        tree = tree.insert(i, std::move(v));
+    } else {
+        auto& lst = mutableList();
+        lst.insert(lst.begin() + i, std::move(v));
+    }
+}
+
+void Value::eraseElement(size_t i) {
+    if (isPacked()) {
+        auto& lst = mutableNumbers();
+        lst.erase(lst.begin() + i);
+    } else if (updatesPersistently()) {
+        auto& tree = std::get<PersistentList>(data_);
+        tree = tree.erase(i);
+    } else {
+        auto& lst = mutableList();
+        lst.erase(lst.begin() + i);
+    }
+}
+
+void Value::setElement(size_t i, Value v) {
+    double x;
+    if (isPacked() && packable(v, x)) {
+        mutableNumbers()[i] = x;
+    } else if (updatesPersistently()) {
+        std::get<PersistentList>(data_).update(i, std::move(v));
+    } else {
+        mutableList()[i] = std::move(v);
+    }
+}
+
+void Value::appendList(const Value& tail) {
+    auto rhs = tail.asList();
+    if (isPacked() && rhs.isPacked()) {
+        auto& out = mutableNumbers();
+        out.insert(out.end(), rhs.numbers().begin(), rhs.numbers().end());
+    } else if (rhs.isPersistent() || updatesPersistently()) {
+        auto asTree = [](const ListView& lst) {
+            return lst.isPersistent() ? lst.tree()
+                                      : PersistentList(lst.begin(), lst.end());
+        };
+        data_ = PersistentList::concat(asTree(asList()), asTree(rhs));
+    } else {
+        auto& out = mutableList();
+        out.insert(out.end(), rhs.begin(), rhs.end());
+    }
+}
+
+bool Value::packable(const Value& v, double& out) noexcept {
+    constexpr std::int64_t kExact = std::int64_t{1} << 53;
+    if (v.type_ != Type::Number) return false;
+    if (const auto* i = std::get_if<std::int64_t>(&v.data_)) {
+        if (*i < -kExact || *i > kExact) return false;
+        out = static_cast<double>(*i);
+        return true;
+    }
+    out = std::get<double>(v.data_);
+    return true;
+}
+
+Value Value::unpacked(double x) noexcept {
+    constexpr double kExact = 9007199254740992.0;  // 2^53
+    if (x >= -kExact && x <= kExact) {
+        auto i = static_cast<std::int64_t>(x);
+        if (static_cast<double>(i) == x && !(i == 0 && std::signbit(x)))
+            return Value(i);
+    }
+    return Value(x);
+}
+
+Value Value::slice(size_t start, size_t end) const {
+    Value out = *this;
+    auto narrow = [&](auto& d) {
+        d.off += start;
+        d.len = end - start;
+    };
+    if (type_ == Type::String) {
+        narrow(std::get<Shared<std::string>>(out.data_));
+    } else if (isPacked()) {
+        narrow(std::get<Shared<NumArray>>(out.data_));
+    } else if (isPersistent()) {
+        auto& tree = std::get<PersistentList>(out.data_);
+        tree = tree.slice(start, end);
+    } else if (type_ == Type::List) {
+        narrow(std::get<Shared<ListType>>(out.data_));
+    } else {
+        throw std::runtime_error("Not a string or list");
+    }
+    return out;
+}
+
+namespace {
+
+// "[a, b, c]" for the elements of a list-like container.
+template <typename Items>
+std::string joined(const Items& items) {
+    std::string out = "[";
+    bool first = true;
+    for (const auto& item : items) {
+        if (!first) out += ", ";
+        out += item.toString();
+        first = false;
+    }
+    out += "]";
+    return out;
+}
+
+}  // namespace
+
 std::string Value::toString() const {
     switch (type_) {
         case Type::Number: {
+            if (isInteger()) return std::to_string(asInteger());
             double v = asNumber();
             if (std::floor(v) == v) {
-                return std::to_string((long long)v);
+                if (std::fabs(v) < 9223372036854775808.0) {
+                    return std::to_string((long long)v);
+                }
+                char buf[400];
+                std::snprintf(buf, sizeof buf, "%.0f", v);
+                return buf;
             } else {
                 return std::to_string(v);
             }
         }
         case Type::String:
-            return asString();
+            return std::string(asString());
         case Type::Boolean:
             return asBoolean() ? "true" : "false";
         case Type::Nil:
             return "nil";
-        case Type::List: {
-            const auto& lst = asList();
-            std::string out = "[";
-            for (size_t i = 0; i < lst.size(); ++i) {
-                out += lst[i].toString();
-                if (i + 1 < lst.size()) out += ", ";
-            }
-            out += "]";
-            return out;
-        }
+        case Type::List:
+            return joined(asList());
         case Type::Function:
             return "<function>";
+        case Type::Heap:
+            return "heap" + joined(asHeap().ordered());
+        case Type::Deque:
+            return "deque" + joined(asDeque());
+        case Type::OrderedMap:
+            return (asOrderedMap().isSet() ? "ordered_set" : "ordered_map") +
+                   joined(asOrderedMap().elements());
     }
     return "";
 }
 
+int compareKeys(const Value& a, const Value& b) {
+    if (a.type() == Value::Type::String && b.type() == Value::Type::String) {
+        int c = a.asString().compare(b.asString());
+        return c < 0 ? -1 : c > 0;
+    }
+    if (a.type() != Value::Type::Number || b.type() != Value::Type::Number) {
+        throw std::runtime_error("keys must be all numbers or all strings");
+    }
+    if (a.isInteger() && b.isInteger()) {
+        std::int64_t i = a.asInteger(), j = b.asInteger();
+        return i < j ? -1 : i > j;
+    }
+    double x = a.asNumber(), y = b.asNumber();
+    return x < y ? -1 : x > y;
+}
+
 }  // namespace itmoscript
@@ -407,6 +407,34 @@ TEST(FunctionTestSuite, FibonacciRecursion) {
     ASSERT_EQ(out, expected);
 }
 
+TEST(FunctionTestSuite, ReturnFromNestedLoops) {
+    std::string code = R"(
+        find = function(grid, target)
+            i = 0
+            while i < len(grid)
+                for x in grid[i]
+                    if x == target then
+                        return i
+                    end if
+                end for
+                i += 1
+            end while
+            return -1
+        end function
+
+        g = [[1, 2], [3, 4], [5, 6]]
+        print(find(g, 4), find(g, 5), find(g, 7))
+        for x in [1, 2, 3]
+            print(find(g, x))
+        end for
+    )";
+
+    std::string expected = "12-1001";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, expected);
+}
+
 TEST(FunctionTestSuite, CallingNonFunctionError) {
     std::string code = R"(
         x = 5
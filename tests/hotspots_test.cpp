@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <itmoscript/hotspots.h>
+#include <itmoscript/interpreter.h>
+
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+std::string report(const std::string& code) {
+    Hotspots hotspots;
+    InterpreterOptions options{.workers = 1, .hotspots = &hotspots};
+    std::istringstream input(code), runtime;
+    std::ostringstream output, out;
+    interpret(input, runtime, output, options);
+    hotspots.writeReport(out);
+    return out.str();
+}
+
+// The execution count in the report row for the source line text.
+long countOf(const std::string& report, const std::string& text) {
+    size_t at = report.find(": " + text + "\n");
+    if (at == std::string::npos) return -1;
+    size_t begin = report.rfind('\n', at) + 1;
+    return std::stol(report.substr(begin));
+}
+
+}  // namespace
+
+TEST(HotspotsSuite, CountsStatementExecutionsPerLine) {
+    std::string code = R"(square = function(x)
+    return x * x
+end function
+i = 0
+while i < 10
+    s = square(i)
+    i = i + 1
+end while
+)";
+    std::string out = report(code);
+    ASSERT_EQ(countOf(out, "return x * x"), 10) << out;
+    ASSERT_EQ(countOf(out, "s = square(i)"), 10) << out;
+    ASSERT_EQ(countOf(out, "while i < 10"), 11) << out;
+    ASSERT_EQ(countOf(out, "i = 0"), 1) << out;
+}
+
+TEST(HotspotsSuite, KeepsCountsOfFailedRuns) {
+    std::string out = report("x = 1\ny = x + nil\nprint(x)\n");
+    ASSERT_EQ(countOf(out, "y = x + nil"), 1) << out;
+    ASSERT_EQ(out.find("print"), std::string::npos) << out;
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <itmoscript/interpreter.h>
 
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -58,3 +59,20 @@ TEST(IllegalOperationsSuite, MultiLineStatement) {
     ASSERT_FALSE(interpret(input, output));
     ASSERT_FALSE(output.str().ends_with(kUnreachable));
 }
+
+TEST(IllegalOperationsSuite, ErrorReportsSourceLine) {
+    std::string code = R"(x = 1
+f = function(a)
+    return a + nil
+end function
+y = f(2)
+)";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    testing::internal::CaptureStderr();
+    ASSERT_FALSE(interpret(input, output));
+    std::string error = testing::internal::GetCapturedStderr();
+    ASSERT_NE(error.find("at line 3, column 5"), std::string::npos) << error;
+}
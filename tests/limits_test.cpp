@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+// Runs code under limits; returns the kind of limit it exceeded, or
+// nothing when it finished.
+std::optional<LimitExceeded::Kind> exceeded(const std::string& code,
+                                            const Limits& limits,
+                                            size_t workers = 1) {
+    InterpreterOptions options{.workers = workers, .limits = limits};
+    std::istringstream input(code), runtime;
+    std::ostringstream output;
+    try {
+        interpret(input, runtime, output, options);
+    } catch (const LimitExceeded& e) {
+        return e.kind();
+    }
+    return std::nullopt;
+}
+
+const std::string kForever = R"(
+    i = 0
+    while true
+        i = i + 1
+    end while
+)";
+
+}  // namespace
+
+TEST(LimitsSuite, StopsAfterOperationBudget) {
+    ASSERT_EQ(exceeded(kForever, {.operations = 10000}),
+              LimitExceeded::Kind::Operations);
+}
+
+TEST(LimitsSuite, OperationBudgetCountsIterationsAndCalls) {
+    std::string code = R"(
+        f = function() return 1 end function
+        i = 0
+        while i < 10
+            f()
+            i = i + 1
+        end while
+    )";
+    ASSERT_EQ(exceeded(code, {.operations = 20}), std::nullopt);
+    ASSERT_EQ(exceeded(code, {.operations = 19}),
+              LimitExceeded::Kind::Operations);
+}
+
+TEST(LimitsSuite, StopsAfterWallTime) {
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(exceeded(kForever, {.wallTime = std::chrono::milliseconds(50)}),
+              LimitExceeded::Kind::WallTime);
+    ASSERT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::seconds(5));
+}
+
+TEST(LimitsSuite, StopsRunawayRecursion) {
+    std::string code = R"(
+        f = function(n) return f(n + 1) end function
+        f(0)
+    )";
+    ASSERT_EQ(exceeded(code, {.callDepth = 50}),
+              LimitExceeded::Kind::CallDepth);
+}
+
+TEST(LimitsSuite, StopsRunawayGrowth) {
+    std::string code = R"(
+        x = []
+        while true
+            x = push(x, "abcdefghijklmnopqrstuvwxyz")
+        end while
+    )";
+    ASSERT_EQ(exceeded(code, {.heapBytes = 4 << 20}),
+              LimitExceeded::Kind::HeapBytes);
+}
+
+TEST(LimitsSuite, StopsLargeAllocationsBeforeTheyHappen) {
+    // Each would need gigabytes, long before the heap is next checked.
+    Limits limits{.heapBytes = 4 << 20};
+    ASSERT_EQ(exceeded("x = range(0, 1000000000, 1)\n", limits),
+              LimitExceeded::Kind::HeapBytes);
+    ASSERT_EQ(exceeded("s = \"abc\" * 1000000000\n", limits),
+              LimitExceeded::Kind::HeapBytes);
+    ASSERT_EQ(exceeded("xs = [nil]\nxs *= 1000000000\n", limits),
+              LimitExceeded::Kind::HeapBytes);
+    ASSERT_EQ(exceeded("x = range(0, 1000, 1)\ns = \"abc\" * 1000\n", limits),
+              std::nullopt);
+}
+
+TEST(LimitsSuite, AppliesToParallelWorkers) {
+    std::string code = R"(
+        spin = function(x)
+            while true
+                x = x + 1
+            end while
+        end function
+        r = parallel_map(range(0, 8, 1), spin)
+    )";
+    ASSERT_EQ(exceeded(code, {.operations = 100000}, 2),
+              LimitExceeded::Kind::Operations);
+}
+
+TEST(LimitsSuite, ParallelWorkersShareTheBudget) {
+    // Each element takes about 500 operations, and no worker alone goes
+    // over the limit.
+    std::string code = R"(
+        f = function(x)
+            i = 0
+            while i < 500
+                i = i + 1
+            end while
+            return i
+        end function
+        r = parallel_map(range(0, 16, 1), f)
+    )";
+    ASSERT_EQ(exceeded(code, {.operations = 1000}, 4),
+              LimitExceeded::Kind::Operations);
+    ASSERT_EQ(exceeded(code, {.operations = 20000}, 4), std::nullopt);
+}
+
+TEST(LimitsSuite, ScriptErrorsAreNotLimits) {
+    std::istringstream input("x = 1 + nil"), runtime;
+    std::ostringstream output;
+    InterpreterOptions options{.limits = {.operations = 10}};
+    ASSERT_FALSE(interpret(input, runtime, output, options));
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <itmoscript/ordered_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace itmoscript;
+
+TEST(OrderedMapSuite, RandomEditsMatchMap) {
+    std::mt19937 gen(7);
+    OrderedMap m(false);
+    std::map<std::int64_t, std::int64_t> model;
+    for (int step = 0; step < 20000; ++step) {
+        std::int64_t k = gen() % 3000;
+        auto key = Value::makeInteger(k);
+        if (gen() % 3 != 0) {
+            bool added = m.insert(key, Value::makeInteger(step));
+            ASSERT_EQ(added, !model.count(k));
+            model[k] = step;
+        } else {
+            ASSERT_EQ(m.erase(key), model.erase(k) == 1);
+        }
+        ASSERT_EQ(m.size(), model.size());
+
+        auto probe = Value::makeInteger(gen() % 3000);
+        auto lower = model.lower_bound(probe.asInteger());
+        size_t rank = std::distance(model.begin(), lower);
+        ASSERT_EQ(m.rank(probe), rank);
+        if (lower != model.end()) {
+            ASSERT_EQ(m.at(rank).key.asInteger(), lower->first);
+            ASSERT_EQ(m.at(rank).value.asInteger(), lower->second);
+        }
+        const auto* e = m.find(probe);
+        ASSERT_EQ(e != nullptr, model.count(probe.asInteger()) == 1);
+    }
+}
+
+TEST(OrderedMapSuite, CopyIsIndependent) {
+    OrderedMap a(true);
+    for (int i = 0; i < 500; ++i) a.insert(Value::makeInteger(i), Value());
+    OrderedMap b(a);
+    for (int i = 0; i < 500; i += 2) b.erase(Value::makeInteger(i));
+    ASSERT_EQ(a.size(), 500);
+    ASSERT_EQ(b.size(), 250);
+    ASSERT_EQ(b.elements().front().asInteger(), 1);
+    ASSERT_EQ(a.elements().back().asInteger(), 499);
+}
+
+TEST(OrderedMapSuite, CopiesShareWhatTheyDoNotChange) {
+    std::mt19937 gen(11);
+    OrderedMap m(false);
+    std::map<std::int64_t, std::int64_t> model;
+    std::vector<std::pair<OrderedMap, std::map<std::int64_t, std::int64_t>>>
+        versions;
+    for (int step = 0; step < 6000; ++step) {
+        std::int64_t k = gen() % 2000;
+        if (gen() % 3 != 0) {
+            m.insert(Value::makeInteger(k), Value::makeInteger(step));
+            model[k] = step;
+        } else {
+            m.erase(Value::makeInteger(k));
+            model.erase(k);
+        }
+        if (step % 500 == 0) versions.emplace_back(m, model);
+    }
+    for (const auto& [version, expected] : versions) {
+        ASSERT_EQ(version.size(), expected.size());
+        size_t i = 0;
+        for (const auto& [k, v] : expected) {
+            ASSERT_EQ(version.at(i).key.asInteger(), k);
+            ASSERT_EQ(version.at(i++).value.asInteger(), v);
+        }
+    }
+
+    // Changing the end of a copy leaves the leaves at the start shared.
+    OrderedMap copy(m);
+    copy.insert(Value::makeInteger(5000), Value());
+    ASSERT_EQ(&copy.at(0), &m.at(0));
+    ASSERT_NE(&copy.at(m.size() - 1), &m.at(m.size() - 1));
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <itmoscript/persistent_vector.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+using namespace itmoscript;
+
+namespace {
+
+std::vector<int> contents(const PersistentVector<int>& v) {
+    std::vector<int> out;
+    for (size_t i = 0; i < v.size(); ++i) out.push_back(v[i]);
+    return out;
+}
+
+}  // namespace
+
+TEST(PersistentVectorSuite, BuildsFromRange) {
+    std::vector<int> items(5000);
+    for (int i = 0; i < 5000; ++i) items[i] = i * 3;
+    PersistentVector<int> v(items.begin(), items.end());
+    ASSERT_EQ(v.size(), items.size());
+    ASSERT_EQ(contents(v), items);
+    ASSERT_TRUE(PersistentVector<int>().empty());
+}
+
+TEST(PersistentVectorSuite, UpdatesLeaveOriginalIntact) {
+    std::vector<int> items(1000, 7);
+    PersistentVector<int> v(items.begin(), items.end());
+    auto pushed = v.pushBack(1);
+    auto changed = v.set(500, 2);
+    auto inserted = v.insert(0, 3);
+    auto erased = v.erase(999);
+    ASSERT_EQ(contents(v), items);
+    ASSERT_EQ(pushed.size(), 1001);
+    ASSERT_EQ(pushed[1000], 1);
+    ASSERT_EQ(changed[500], 2);
+    ASSERT_EQ(inserted[0], 3);
+    ASSERT_EQ(inserted[1000], 7);
+    ASSERT_EQ(erased.size(), 999);
+}
+
+TEST(PersistentVectorSuite, RandomEditsMatchVector) {
+    std::mt19937 gen(42);
+    PersistentVector<int> v;
+    std::vector<int> model;
+    for (int step = 0; step < 6000; ++step) {
+        size_t n = model.size();
+        switch (gen() % 6) {
+            case 0:
+            case 1: {
+                size_t i = gen() % (n + 1);
+                v = v.insert(i, step);
+                model.insert(model.begin() + i, step);
+                break;
+            }
+            case 2:
+                if (n > 0) {
+                    size_t i = gen() % n;
+                    v = v.erase(i);
+                    model.erase(model.begin() + i);
+                }
+                break;
+            case 3:
+                if (n > 0) {
+                    size_t i = gen() % n;
+                    v = v.set(i, -step);
+                    model[i] = -step;
+                }
+                break;
+            case 4: {
+                size_t from = gen() % (n + 1);
+                size_t to = from + gen() % (n - from + 1);
+                auto part = v.slice(from, to);
+                ASSERT_EQ(contents(part),
+                          std::vector<int>(model.begin() + from,
+                                           model.begin() + to));
+                break;
+            }
+            case 5: {
+                auto both = PersistentVector<int>::concat(v, v);
+                auto twice = model;
+                twice.insert(twice.end(), model.begin(), model.end());
+                if (step % 50 == 0) {
+                    ASSERT_EQ(contents(both), twice);
+                }
+                if (n < 3000) {
+                    v = both;
+                    model = twice;
+                }
+                break;
+            }
+        }
+        ASSERT_EQ(v.size(), model.size());
+    }
+    ASSERT_EQ(contents(v), model);
+
+    size_t start = 0;
+    for (size_t i = 0; i < v.size(); i += 97) {
+        auto leaf = v.leafAt(i, start);
+        ASSERT_LE(start, i);
+        ASSERT_EQ(leaf[i - start], model[i]);
+    }
+}
+
+TEST(PersistentVectorSuite, ChangesUnsharedNodesInPlace) {
+    std::vector<int> items(1000, 7);
+    PersistentVector<int> v(items.begin(), items.end());
+    auto copy = v;
+    v.update(500, 1);
+    v.append(2);
+    ASSERT_EQ(contents(copy), items);
+    ASSERT_EQ(v[500], 1);
+    ASSERT_EQ(v[1000], 2);
+
+    // The copy no longer shares the path to element 500.
+    const int* at = &v[500];
+    v.update(500, 3);
+    ASSERT_EQ(&v[500], at);
+    ASSERT_EQ(v[500], 3);
+
+    std::vector<int> model = contents(v), copied;
+    for (int i = 0; i < 3000; ++i) {
+        v.append(i);
+        model.push_back(i);
+        if (i % 7 == 0) {
+            v.update(i * 13 % model.size(), -i);
+            model[i * 13 % model.size()] = -i;
+        }
+        if (i % 500 == 0) {
+            copy = v;
+            copied = model;
+        }
+    }
+    ASSERT_EQ(contents(v), model);
+    ASSERT_EQ(contents(copy), copied);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/profiler.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+// Runs code under profiler until it has taken some samples.
+void profile(const std::string& code, Profiler& profiler) {
+    InterpreterOptions options{.workers = 1, .profiler = &profiler};
+    for (int attempt = 0; attempt < 20 && profiler.samples() == 0; ++attempt) {
+        std::istringstream input(code), runtime;
+        std::ostringstream output;
+        ASSERT_TRUE(interpret(input, runtime, output, options));
+    }
+    ASSERT_GT(profiler.samples(), 0);
+}
+
+}  // namespace
+
+TEST(ProfilerSuite, AttributesSamplesToScriptFunctions) {
+    std::string code = R"(
+        spin = function(n)
+            i = 0
+            while i < n
+                i = i + 1
+            end while
+        end function
+        outer = function()
+            spin(50000)
+        end function
+        outer()
+    )";
+    Profiler profiler(std::chrono::microseconds(100));
+    profile(code, profiler);
+
+    std::ostringstream report, folded;
+    profiler.writeReport(report);
+    profiler.writeFolded(folded);
+    ASSERT_NE(report.str().find("spin"), std::string::npos);
+    ASSERT_NE(folded.str().find("<main>;outer;spin "), std::string::npos);
+}
+
+TEST(ProfilerSuite, AttributesSamplesToSourceLines) {
+    std::string code = R"(i = 0
+while i < 100000
+    i = i + 1
+end while
+)";
+    Profiler profiler(std::chrono::microseconds(100));
+    profile(code, profiler);
+
+    std::ostringstream report;
+    profiler.writeReport(report);
+    bool inLoop = report.str().find("     2  <main>") != std::string::npos ||
+                  report.str().find("     3  <main>") != std::string::npos;
+    ASSERT_TRUE(inLoop) << report.str();
+}
+
+TEST(ProfilerSuite, NoSamplesWithoutTicks) {
+    Profiler profiler;
+    std::ostringstream folded;
+    profiler.writeFolded(folded);
+    ASSERT_EQ(profiler.samples(), 0);
+    ASSERT_EQ(folded.str(), "");
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/statement_reader.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace itmoscript;
+
+namespace {
+
+// Runs code in session and returns what it printed.
+std::string run(Session& session, std::ostringstream& out,
+                const std::string& code, bool ok = true) {
+    out.str("");
+    std::istringstream input(code);
+    EXPECT_EQ(session.run(input), ok) << code;
+    return out.str();
+}
+
+}  // namespace
+
+TEST(SessionSuite, KeepsDefinitionsBetweenRuns) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    ASSERT_EQ(run(session, out, "x = 20\n"), "");
+    ASSERT_EQ(run(session, out,
+                  "twice = function(n)\n    return n * 2\nend function\n"),
+              "");
+    ASSERT_EQ(run(session, out, "print(twice(x) + 2)\n"), "42");
+}
+
+TEST(SessionSuite, RunsOnlyTheNewStatements) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    ASSERT_EQ(run(session, out, "n = 0\nn = n + 1\nprint(n)\n"), "1");
+    ASSERT_EQ(run(session, out, "n = n + 1\nprint(n)\n"), "2");
+}
+
+TEST(SessionSuite, GoesOnAfterAnError) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    run(session, out,
+        "f = function(n)\n    inner = n\n    return n + nil\nend function\n");
+    testing::internal::CaptureStderr();
+    ASSERT_EQ(run(session, out, "print(1)\nf(2)\nprint(3)\n", false), "1");
+    ASSERT_NE(testing::internal::GetCapturedStderr(), "");
+
+    // The failed call's frame is gone: its local does not show at the top.
+    testing::internal::CaptureStderr();
+    run(session, out, "print(inner)\n", false);
+    ASSERT_NE(testing::internal::GetCapturedStderr().find("inner"),
+              std::string::npos);
+
+    testing::internal::CaptureStderr();
+    run(session, out, "while\n", false);
+    testing::internal::GetCapturedStderr();
+    ASSERT_EQ(run(session, out, "print(\"still here\")\n"), "still here");
+}
+
+TEST(SessionSuite, ReaderPromptsForEachLine) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    std::istringstream input("if true then\n    print(1)\nend if\nx = 2\n");
+    StatementReader reader(input);
+    std::vector<bool> prompts;
+    reader.setPrompt([&](bool continued) { prompts.push_back(continued); });
+    ASSERT_TRUE(session.run(reader));
+    ASSERT_EQ(out.str(), "1");
+    // The last prompt meets the end of the input.
+    ASSERT_EQ(prompts, (std::vector<bool>{false, true, true, false, false}));
+}
+
+TEST(SessionSuite, GoesOnAfterALimitBreach) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1, .limits = {.callDepth = 20}});
+
+    run(session, out, "f = function(n)\n    return f(n + 1)\nend function\n");
+    std::istringstream deep("f(1)\n");
+    ASSERT_THROW(session.run(deep), LimitExceeded);
+    // The frames of the calls are gone, and the limits start over.
+    testing::internal::CaptureStderr();
+    run(session, out, "print(n)\n", false);
+    testing::internal::GetCapturedStderr();
+    ASSERT_EQ(run(session, out, "x = 1\nprint(x)\n"), "1");
+    std::istringstream again("f(1)\n");
+    ASSERT_THROW(session.run(again), LimitExceeded);
+}
+
+TEST(SessionSuite, KeepsAVariableWhoseLastUseFails) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    run(session, out, "lst = [1, 2, 3]\ns = \"abc\"\n");
+    testing::internal::CaptureStderr();
+    run(session, out, "lst = insert(lst, 100, 9)\n", false);
+    run(session, out, "s = replace(s, 1, \"x\")\n", false);
+    run(session, out, "s = s + 1\n", false);
+    // An operator above the last use fails after it took the value.
+    run(session, out, "s = s + \"a\" + 1\n", false);
+    run(session, out, "lst = push(lst, 4) + 1\n", false);
+    testing::internal::GetCapturedStderr();
+    ASSERT_EQ(run(session, out, "print(lst)\nprint(s)\n"), "[1, 2, 3]abc");
+}
+
+TEST(SessionSuite, KeepsAVariableWhoseCompoundAssignmentFails) {
+    std::istringstream runtime;
+    std::ostringstream out;
+    Session session(runtime, out, {.workers = 1});
+
+    run(session, out, "s = \"abc\"\nlst = [1]\n");
+    testing::internal::CaptureStderr();
+    run(session, out, "s += 1\n", false);
+    run(session, out, "s -= \"x\"\n", false);
+    run(session, out, "lst *= nil\n", false);
+    testing::internal::GetCapturedStderr();
+    ASSERT_EQ(run(session, out, "print(s)\nprint(lst)\n"), "abc[1]");
+}
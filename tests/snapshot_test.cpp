@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/tracer.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+// A file in the temporary directory, removed with the object.
+struct TempFile {
+    std::string path;
+    explicit TempFile(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {}
+    ~TempFile() { std::remove(path.c_str()); }
+};
+
+bool run(const std::string& code, std::string& out,
+         InterpreterOptions options) {
+    options.workers = 1;
+    std::istringstream input(code), runtime;
+    std::ostringstream output;
+    bool ok = interpret(input, runtime, output, options);
+    out = output.str();
+    return ok;
+}
+
+// Restores bytes from a file and returns what was reported.
+std::string restoreError(const std::string& bytes) {
+    TempFile file("itmoscript_snapshot_damaged.snap");
+    std::ofstream(file.path, std::ios::binary) << bytes;
+    std::string out;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(run("print(1)\n", out, {.restoreSnapshot = file.path}));
+    EXPECT_EQ(out, "");
+    return testing::internal::GetCapturedStderr();
+}
+
+// A snapshot of version 2 with body, sealed with its FNV-1a checksum.
+std::string sealed(const std::string& body) {
+    std::string bytes = std::string("ITMOSNAP\x02") + body;
+    std::uint64_t h = 0xcbf29ce484222325;
+    for (char c : bytes) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3;
+    }
+    for (int i = 0; i < 8; ++i) bytes += static_cast<char>(h >> 8 * i);
+    return bytes;
+}
+
+// Runs setup and saves a snapshot of it, then runs code from the snapshot.
+std::string restored(const std::string& setup, const std::string& code) {
+    TempFile file("itmoscript_snapshot_test.snap");
+    std::string out;
+    EXPECT_TRUE(run(setup, out, {.saveSnapshot = file.path}));
+    EXPECT_TRUE(run(code, out, {.restoreSnapshot = file.path}));
+    return out;
+}
+
+}  // namespace
+
+TEST(SnapshotSuite, RestoresValues) {
+    std::string setup = R"(
+        n = 42
+        x = 0.25
+        yes = true
+        none = nil
+        s = "text"
+        xs = [1, "two", [3.5, nil]]
+        packed = range(0, 5, 1)
+        d = deque([1, 2])
+        h = heap()
+        h = heap_push(h, 3)
+        h = heap_push(h, 1)
+        m = ordered_map([["b", 2], ["a", 1]])
+    )";
+    std::string code = R"(
+        print(n, " ", x, " ", yes, " ", none, " ", s, " ", xs, " ", packed)
+        print(" ", len(d), " ", heap_top(h), " ", m)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(setup + code, out, {}));
+    ASSERT_EQ(restored(setup, code), out);
+}
+
+TEST(SnapshotSuite, RestoresFunctionsWithTheirCaptures) {
+    std::string setup = R"(
+        base = 10
+        add = function(x)
+            return x + base
+        end function
+        fact = function(n)
+            if n <= 1 then
+                return 1
+            end if
+            return n * fact(n - 1)
+        end function
+        compose = function(f, g)
+            return function(x)
+                return f(g(x))
+            end function
+        end function
+        both = compose(add, fact)
+        show = println
+    )";
+    std::string code = R"(
+        base = 0
+        show(add(1), " ", fact(5), " ", both(3))
+    )";
+    ASSERT_EQ(restored(setup, code), "11 120 16\n");
+}
+
+TEST(SnapshotSuite, SavesBuiltinsWhileTracing) {
+    TempFile file("itmoscript_snapshot_traced.snap");
+    Tracer tracer;
+    std::string out;
+    // Tracing wraps every builtin in a callable of the same type.
+    ASSERT_TRUE(run("p = print\nfs = [len, p]\n", out,
+                    {.tracer = &tracer, .saveSnapshot = file.path}));
+    ASSERT_TRUE(run("n = fs[0]\nq = fs[1]\np(n(\"abc\"))\nq(4)\n", out,
+                    {.restoreSnapshot = file.path}));
+    ASSERT_EQ(out, "34");
+}
+
+TEST(SnapshotSuite, StoresSharedBuffersOnce) {
+    TempFile one("itmoscript_snapshot_one.snap");
+    TempFile two("itmoscript_snapshot_two.snap");
+    std::string setup = "xs = range(0, 10000, 1)\n";
+    std::string out;
+    ASSERT_TRUE(run(setup, out, {.saveSnapshot = one.path}));
+    ASSERT_TRUE(run(setup + "ys = xs\nf = function()\n    return 1\n"
+                            "end function\n",
+                    out, {.saveSnapshot = two.path}));
+    auto size = [](const std::string& path) {
+        return std::filesystem::file_size(path);
+    };
+    ASSERT_LT(size(two.path), size(one.path) + 1000);
+}
+
+TEST(SnapshotSuite, RejectsMalformedFiles) {
+    TempFile file("itmoscript_snapshot_bad.snap");
+    std::ofstream(file.path) << "ITMOSNAP\x02\x05garbage";
+    std::string out;
+    testing::internal::CaptureStderr();
+    ASSERT_FALSE(run("print(1)\n", out, {.restoreSnapshot = file.path}));
+    ASSERT_NE(testing::internal::GetCapturedStderr().find("snapshot"),
+              std::string::npos);
+    ASSERT_EQ(out, "");
+}
+
+TEST(SnapshotSuite, RejectsDamagedFiles) {
+    TempFile file("itmoscript_snapshot_whole.snap");
+    std::string out;
+    ASSERT_TRUE(run("f = function(x)\n    return x\nend function\n", out,
+                    {.saveSnapshot = file.path}));
+    std::ifstream in(file.path, std::ios::binary);
+    std::string whole((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    const std::string kMalformed = "Malformed snapshot";
+
+    // Cut short.
+    ASSERT_NE(restoreError(whole.substr(0, whole.size() - 5)).find(kMalformed),
+              std::string::npos);
+    // One byte changed.
+    std::string flipped = whole;
+    flipped[whole.size() / 2] ^= 1;
+    ASSERT_NE(restoreError(flipped).find(kMalformed), std::string::npos);
+    // A variable refers to object 3 of none.
+    ASSERT_NE(restoreError(sealed(std::string("\x00\x01\x01x\x05\x03", 6)))
+                  .find(kMalformed),
+              std::string::npos);
+    // A function whose body is a while loop with no children.
+    std::string definition("\x01\x08\x01"
+                           "f"
+                           "\x0c\x00\x00\x00\x00\x00\x01"
+                           "\x01\x00\x00\x00\x00\x00\x01"
+                           "\x0a\x00\x00\x00\x00\x00\x00"
+                           "\x00",
+                           26);
+    ASSERT_NE(restoreError(sealed(definition)).find(kMalformed),
+              std::string::npos);
+    // A heap keyed by the number 7.
+    ASSERT_NE(restoreError(sealed(std::string("\x01\x06\x03\x0e\x00"
+                                              "\x01\x01h\x05\x00",
+                                              10)))
+                  .find(kMalformed),
+              std::string::npos);
+}
@@ -211,6 +211,89 @@ TEST(NumberStdLibSuite, ToStringFloat) {
     ASSERT_EQ(out, "2.718000");
 }
 
+TEST(NumberStdLibSuite, BitCounts) {
+    std::string code = R"(
+        println(popcount(255), " ", popcount(-1), " ", popcount(0))
+        println(clz(1), " ", clz(0), " ", clz(-1))
+        println(ctz(8), " ", ctz(0), " ", ctz(12.0))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "8 64 0\n63 64 0\n3 64 2\n");
+}
+
+TEST(NumberStdLibSuite, BitCountsRequireIntegers) {
+    std::string code = R"(
+        print(popcount(1.5))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(NumberStdLibSuite, SumMinMax) {
+    std::string code = R"(
+        xs = [3, 1, 4, 1, 5, 9, 2, 6]
+        print(sum(xs), " ", min(xs), " ", max(xs), " ", min(3, 2.5, 7))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "31 1 9 2.500000");
+}
+
+TEST(NumberStdLibSuite, SumOfEmptyAndOverflow) {
+    std::string code = R"(
+        print(sum([]), " ", sum([9223372036854775807, 1]))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "0 9223372036854775808");
+}
+
+TEST(NumberStdLibSuite, ArgMinArgMaxFirstIndex) {
+    std::string code = R"(
+        xs = mul(range(0, 20, 1), 0.5)
+        print(argmin([2, 1, 1]), argmax([1, 3, 3]), " ", argmax(xs))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "11 19");
+}
+
+TEST(NumberStdLibSuite, MinOfEmptyListError) {
+    std::string code = R"(
+        print(min([]))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(NumberStdLibSuite, DotAndCumsum) {
+    std::string code = R"(
+        xs = [1, 2, 3]
+        print(dot(xs, xs), " ", dot([0.5, 2], [4, 1]), cumsum([1, 2.5, 3]))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "14 4[1, 3.500000, 6.500000]");
+}
+
+TEST(NumberStdLibSuite, ElementwiseAddMul) {
+    std::string code = R"(
+        print(add([1, 2], [10, 20]), mul([1, 2], 0.5), add(2, 3))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[11, 22][0.500000, 1]5");
+}
+
+TEST(NumberStdLibSuite, ElementwiseLengthMismatchError) {
+    std::string code = R"(
+        print(add([1, 2], [1]))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
 TEST(StringStdLibSuite, LenStringEmpty) {
     std::string code = R"(
         print(len(""))
@@ -531,6 +614,49 @@ TEST(ListStdLibSuite, SortMixedTypes) {
     ASSERT_EQ(out, "[1, 10, 2]");
 }
 
+TEST(ListStdLibSuite, SortByNumericKey) {
+    std::string code = R"(
+        people = [["bob", 31], ["amy", 25], ["cat", 31], ["dan", -4.5]]
+        print(sort_by(people, function(p) return p[1] end function))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[[dan, -4.500000], [amy, 25], [bob, 31], [cat, 31]]");
+}
+
+TEST(ListStdLibSuite, SortByStringKey) {
+    std::string code = R"(
+        words = ["pear", "Fig", "apple", "kiwi"]
+        print(sort_by(words, function(w) return lower(w) end function))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[apple, Fig, kiwi, pear]");
+}
+
+TEST(ListStdLibSuite, SortByCallsKeyOncePerElement) {
+    std::string code = R"(
+        key = function(x)
+            print(x)
+            return 0 - x
+        end function
+        lst = [3, 1, 4, 1, 5]
+        sorted = sort_by(lst, key)
+        print(" ", sorted, " ", lst)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "31415 [5, 4, 3, 1, 1] [3, 1, 4, 1, 5]");
+}
+
+TEST(ListStdLibSuite, SortByMixedKeysError) {
+    std::string code = R"(
+        print(sort_by([1, "a"], function(x) return x end function))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
 TEST(ListStdLibSuite, CombinedOperations) {
     std::string code = R"(
         lst = range(1, 6, 1)      
@@ -545,6 +671,412 @@ TEST(ListStdLibSuite, CombinedOperations) {
     ASSERT_EQ(out, "[2, 3, 4, 5, 7, 10]");
 }
 
+TEST(ListStdLibSuite, PushRebindInLoop) {
+    std::string code = R"(
+        lst = []
+        i = 0
+        while i < 5
+            lst = push(lst, i)
+            i = i + 1
+        end while
+        print(lst)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[0, 1, 2, 3, 4]");
+}
+
+TEST(ListStdLibSuite, RebindKeepsAliasIntact) {
+    std::string code = R"(
+        a = [1]
+        b = a
+        a = push(a, 2)
+        a = insert(a, 0, 0)
+        print(b)
+        print(a)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[1][0, 1, 2]");
+}
+
+TEST(ListStdLibSuite, RebindUsesValueInOtherArgs) {
+    std::string code = R"(
+        a = [1, 2]
+        a = push(a, len(a))
+        a = push(a, a)
+        print(a)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[1, 2, 2, [1, 2, 2]]");
+}
+
+TEST(ListStdLibSuite, RebindComparatorSeesOldList) {
+    std::string code = R"(
+        cmp = function(x, y)
+            if len(lst) != 3 then
+                print("moved")
+            end if
+            return x < y
+        end function
+
+        lst = [3, 1, 2]
+        lst = sort(lst, cmp)
+        print(lst)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[1, 2, 3]");
+}
+
+TEST(ListStdLibSuite, MapSquares) {
+    std::string code = R"(
+        sq = function(x) return x * x end function
+        print(map([1, 2, 3], sq), map([], len), map(["ab", "c"], len))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[1, 4, 9][][2, 1]");
+}
+
+TEST(ListStdLibSuite, FilterEven) {
+    std::string code = R"(
+        even = function(x) return x % 2 == 0 end function
+        print(filter(range(0, 10, 1), even))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[0, 2, 4, 6, 8]");
+}
+
+TEST(ListStdLibSuite, ReduceWithAndWithoutInitial) {
+    std::string code = R"(
+        add = function(a, b) return a + b end function
+        println(reduce([1, 2, 3, 4], add))
+        println(reduce(["b", "c"], add, "a"))
+        println(reduce([], add, 0))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "10\nabc\n0\n");
+}
+
+TEST(ListStdLibSuite, ReduceEmptyWithoutInitialError) {
+    std::string code = R"(
+        print(reduce([], function(a, b) return a end function))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(ListStdLibSuite, AnyAllShortCircuit) {
+    std::string code = R"(
+        big = function(x)
+            print(x)
+            return x > 2
+        end function
+        println(any([1, 3, 5], big), " ", all([3, 1, 5], big))
+        println(any([], big), " ", all([], big))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "1331true false\nfalse true\n");
+}
+
+TEST(ListStdLibSuite, PredicateMustReturnBoolean) {
+    std::string code = R"(
+        print(filter([1, 2], function(x) return x end function))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(ListStdLibSuite, Enumerate) {
+    std::string code = R"(
+        for p in enumerate(["a", "b"])
+            print(p[0], p[1], " ")
+        end for
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "0a 1b ");
+}
+
+TEST(ListStdLibSuite, ArrayFill) {
+    std::string code = R"(
+        xs = array(3, 1.5)
+        print(xs, len(xs), array(2), " ", len(array(0)))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[1.500000, 1.500000, 1.500000]3[0, 0] 0");
+}
+
+TEST(ListStdLibSuite, ArrayFillMustBeNumber) {
+    std::string code = R"(
+        print(array(2, "x"))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(ListStdLibSuite, NumericListsKeepElementsExact) {
+    std::string code = R"(
+        xs = [1, 2.5, -3, 9007199254740993]
+        ys = [1, 2.5, -3]
+        print(xs[3], " ", xs[0] + 9223372036854775806, " ", ys[1:3], ys * 2)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out,
+              "9007199254740993 9223372036854775807 [2.500000, -3][1, "
+              "2.500000, -3, 1, 2.500000, -3]");
+}
+
+TEST(ListStdLibSuite, NumericListTakesOtherValues) {
+    std::string code = R"(
+        xs = push(range(0, 3, 1), 0.5)
+        xs = push(xs, "a")
+        xs = insert(xs, 0, [7])
+        xs = remove(xs, 1)
+        print(xs, xs + [1, 2])
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[[7], 1, 2, 0.500000, a][[7], 1, 2, 0.500000, a, 1, 2]");
+}
+
+TEST(ListStdLibSuite, SetAt) {
+    std::string code = R"(
+        xs = ["a", "b"]
+        ys = set_at(xs, 1, "c")
+        print(xs, ys, set_at([1, 2], 0, 5))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[a, b][a, c][5, 2]");
+}
+
+TEST(ListStdLibSuite, SetAtOutOfBoundsError) {
+    std::string code = R"(
+        print(set_at([1, 2], 2, 0))
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(ListStdLibSuite, UpdatesOfLargeSharedListKeepOriginal) {
+    std::string code = R"(
+        xs = map(range(0, 500, 1), to_string)
+        a = push(xs, "p")
+        b = insert(a, 250, "i")
+        c = remove(b, 0)
+        d = set_at(c, 499, "s") + xs
+        print(len(xs), xs[0], xs[250], xs[499], " ")
+        print(len(a), a[500], " ", b[250], b[251], " ", c[0], " ")
+        print(len(d), d[499], d[500], d[501], " ", d[100:103])
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "5000250499 501p i250 1 1001sp0 [101, 102, 103]");
+}
+
+TEST(HeapStdLibSuite, PopsSmallestFirst) {
+    std::string code = R"(
+        h = heap([5, 1, 4])
+        h = heap_push(h, 2)
+        print(heap_top(h), " ", len(h), " ")
+        h = heap_pop(h)
+        print(heap_top(h), " ", h)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "1 4 2 heap[2, 4, 5]");
+}
+
+TEST(HeapStdLibSuite, PairsOrderByPriorityThenInsertion) {
+    std::string code = R"(
+        h = heap([[2, "b"], [1, "a"], [2, "c"]])
+        h = heap_push(h, [1, "d"])
+        print(h)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "heap[[1, a], [1, d], [2, b], [2, c]]");
+}
+
+TEST(HeapStdLibSuite, KeyFunction) {
+    std::string code = R"(
+        byLen = function(s) return len(s) end function
+        h = heap(["ccc", "a", "bb"], byLen)
+        print(heap_top(h), " ", heap_top(heap_pop(h)))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "a bb");
+}
+
+TEST(HeapStdLibSuite, UpdatesDoNotAffectCopies) {
+    std::string code = R"(
+        a = heap([3, 1])
+        b = heap_pop(a)
+        print(a, b)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "heap[1, 3]heap[3]");
+}
+
+TEST(HeapStdLibSuite, PopEmptyError) {
+    std::string code = R"(
+        h = heap_pop(heap())
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(HeapStdLibSuite, MixedKeysError) {
+    std::string code = R"(
+        h = heap([1, "a"])
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(DequeStdLibSuite, PushAndPopAtBothEnds) {
+    std::string code = R"(
+        d = deque([1, 2])
+        d = push_front(d, 0)
+        d = push_back(d, 3)
+        print(d, len(d), d[0], d[-1], " ")
+        d = pop_front(pop_back(d))
+        print(d)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "deque[0, 1, 2, 3]403 deque[1, 2]");
+}
+
+TEST(DequeStdLibSuite, ForIteratesFrontToBack) {
+    std::string code = R"(
+        for x in push_front(deque(["b"]), "a")
+            print(x)
+        end for
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "ab");
+}
+
+TEST(DequeStdLibSuite, UpdatesDoNotAffectCopies) {
+    std::string code = R"(
+        a = deque([1, 2])
+        b = pop_front(a)
+        print(a, b)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "deque[1, 2]deque[2]");
+}
+
+TEST(DequeStdLibSuite, PopEmptyError) {
+    std::string code = R"(
+        d = pop_front(deque())
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(SortedStdLibSuite, BisectLeftAndRight) {
+    std::string code = R"(
+        x = [1, 3, 3, 5, 10]
+        print(bisect_left(x, 3), bisect_right(x, 3), bisect_left(x, 0))
+        print(bisect_right(x, 11), bisect_left(x, 4.5), " ")
+        print(bisect_left(["apple", "fig", "kiwi"], "grape"))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "13053 2");
+}
+
+TEST(SortedStdLibSuite, SortedInsertKeepsOrder) {
+    std::string code = R"(
+        x = sorted_insert(sorted_insert([2, 4], 3), 2.5)
+        print(x, sorted_insert([], "a"))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "[2, 2.500000, 3, 4][a]");
+}
+
+TEST(SortedStdLibSuite, BisectMixedKeysError) {
+    std::string code = R"(
+        i = bisect_left([1, 2], "a")
+    )";
+    std::string out;
+    ASSERT_FALSE(run(code, out));
+}
+
+TEST(SortedStdLibSuite, OrderedSet) {
+    std::string code = R"(
+        s = ordered_set([5, 1, 3, 3])
+        s = ordered_erase(ordered_insert(s, 4), 1)
+        print(s, len(s), ordered_contains(s, 4), ordered_contains(s, 1), " ")
+        print(ordered_rank(s, 5), ordered_at(s, 0), ordered_lower_bound(s, 4.5))
+        print(ordered_lower_bound(s, 100))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "ordered_set[3, 4, 5]3truefalse 235nil");
+}
+
+TEST(SortedStdLibSuite, OrderedMap) {
+    std::string code = R"(
+        m = ordered_map([["b", 2], ["a", 1]])
+        m = ordered_insert(ordered_insert(m, "c", 3), "a", 0)
+        print(m, ordered_get(m, "a"), ordered_get(m, "z"), ordered_at(m, 2))
+        for p in m
+            print(p[0])
+        end for
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "ordered_map[[a, 0], [b, 2], [c, 3]]0nil[c, 3]abc");
+}
+
+TEST(SortedStdLibSuite, OrderedUpdatesDoNotAffectCopies) {
+    std::string code = R"(
+        a = ordered_set([1, 2])
+        b = ordered_insert(a, 3)
+        print(a, b)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "ordered_set[1, 2]ordered_set[1, 2, 3]");
+}
+
+TEST(ListStdLibSuite, RebindHeapKeySeesOldValue) {
+    std::string code = R"(
+        key = function(v)
+            if h == nil or x == nil then
+                print("moved")
+            end if
+            return v
+        end function
+
+        x = 3
+        h = heap(key)
+        h = heap_push(h, 2)
+        h = heap_push(h, 1)
+        x = heap_push(h, x)
+        print(heap_top(x))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "1");
+}
+
 TEST(SystemStdLibSuite, PrintNoNewline) {
     std::string code = R"(
         print("hello")
@@ -668,3 +1200,40 @@ TEST(SystemStdLibSuite, StacktraceNested) {
     ASSERT_TRUE(run(code, out));
     ASSERT_EQ(out, "[<anonymous>, <anonymous>]");
 }
+
+TEST(SystemStdLibSuite, StatsCountCallsAndFrames) {
+    std::string code = R"(
+        f = function(x) return x end function
+        before = stats()
+        i = 0
+        while i < 10
+            f(i)
+            i = i + 1
+        end while
+        after = stats()
+        calls = ordered_get(after, "calls") - ordered_get(before, "calls")
+        frames = ordered_get(after, "frame_pushes")
+        frames = frames - ordered_get(before, "frame_pushes")
+        print(calls, " ", frames, " ", len(after))
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "10 10 6");
+}
+
+TEST(SystemStdLibSuite, StatsCountBuffersAndCopies) {
+    std::string code = R"(
+        before = stats()
+        a = [1, 2, 3]
+        b = a
+        after = stats()
+        lists = ordered_get(after, "list_buffers")
+        lists = lists - ordered_get(before, "list_buffers")
+        copies = ordered_get(after, "value_copies")
+        copies = copies - ordered_get(before, "value_copies")
+        print(lists, " ", copies > 0)
+    )";
+    std::string out;
+    ASSERT_TRUE(run(code, out));
+    ASSERT_EQ(out, "1 true");
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/statement_reader.h>
+
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+bool runStreaming(const std::string& code, std::string& out) {
+    InterpreterOptions options{.workers = 1, .streaming = true};
+    std::istringstream input(code), runtime;
+    std::ostringstream output;
+    bool ok = interpret(input, runtime, output, options);
+    out = output.str();
+    return ok;
+}
+
+}  // namespace
+
+TEST(StreamingSuite, MatchesWholeProgramRun) {
+    std::string code = R"(
+        double = function(x)
+            return x * 2
+        end function
+        s = "two
+lines"
+        i = 0
+        while i < 3
+            if i == 1 then
+                print(double(i))
+            else if i == 2 then
+                print(s)
+            else
+                print("zero")
+            end if
+            i = i + 1
+        end while
+        for c in [1, 2]
+            print(c)
+        end for
+    )";
+    std::string streamed;
+    ASSERT_TRUE(runStreaming(code, streamed));
+
+    std::istringstream input(code);
+    std::ostringstream whole;
+    ASSERT_TRUE(interpret(input, whole));
+    ASSERT_EQ(streamed, whole.str());
+    ASSERT_EQ(streamed, "zero2two\nlines12");
+}
+
+TEST(StreamingSuite, RunsStatementsBeforeALaterSyntaxError) {
+    std::string out;
+    ASSERT_FALSE(runStreaming("print(1)\nprint(2)\nwhile\n", out));
+    ASSERT_EQ(out, "12");
+}
+
+TEST(StreamingSuite, ListLiteralMaySpanLines) {
+    std::string out;
+    ASSERT_TRUE(runStreaming("x = [1,\n  2,\n  [3,\n 4]]\nprint(x)\n", out));
+    ASSERT_EQ(out, "[1, 2, [3, 4]]");
+}
+
+TEST(StreamingSuite, TopLevelReturnEndsTheProgram) {
+    std::string out;
+    ASSERT_TRUE(runStreaming("print(1)\nreturn 0\nprint(2)\n", out));
+    ASSERT_EQ(out, "1");
+}
+
+TEST(StreamingSuite, ReaderYieldsOneStatementAtATime) {
+    std::istringstream input(
+        "x = 1\n\n// comment\nf = function()\n    return 1\nend function\n"
+        "y = (\n");
+    StatementReader reader(input);
+
+    auto first = reader.next();
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(reader.text(), "x = 1\n");
+    ASSERT_EQ(reader.firstLine(), 1);
+
+    auto second = reader.next();
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(reader.firstLine(), 4);
+    ASSERT_EQ(second->span.line, 4);
+
+    ASSERT_ANY_THROW(reader.next());
+}
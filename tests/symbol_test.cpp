@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <itmoscript/symbol.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace itmoscript;
+
+TEST(SymbolSuite, EqualNamesShareOneEntry) {
+    std::string name = "counter";
+    Symbol a(name);
+    name[0] = 'C';
+    Symbol b("counter");
+    ASSERT_TRUE(a == b);
+    ASSERT_FALSE(a == Symbol(name));
+    ASSERT_EQ(a.str(), "counter");
+    ASSERT_EQ(a.hash(), b.hash());
+    ASSERT_EQ(a.value().toString(), "counter");
+}
+
+TEST(SymbolSuite, ConcurrentInterning) {
+    std::vector<std::vector<Symbol>> seen(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < seen.size(); ++t) {
+        threads.emplace_back([&seen, t] {
+            for (int i = 0; i < 2000; ++i) {
+                seen[t].emplace_back("sym" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (size_t t = 1; t < seen.size(); ++t) {
+        ASSERT_TRUE(seen[t] == seen[0]);
+    }
+}
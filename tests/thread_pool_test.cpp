@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/thread_pool.h>
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace itmoscript;
+
+TEST(ThreadPoolSuite, RunsEveryTaskOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.run(hits.size(), [&](size_t i) { hits[i]++; });
+    for (const auto& h : hits) ASSERT_EQ(h.load(), 1);
+}
+
+TEST(ThreadPoolSuite, RethrowsTaskError) {
+    ThreadPool pool(3);
+    ASSERT_THROW(pool.run(10,
+                          [](size_t i) {
+                              if (i == 7) throw std::runtime_error("boom");
+                          }),
+                 std::runtime_error);
+    std::atomic<int> after = 0;
+    pool.run(5, [&](size_t) { after++; });
+    ASSERT_EQ(after.load(), 5);
+}
+
+TEST(ThreadPoolSuite, ParallelStableSortIsStable) {
+    std::vector<std::pair<int, int>> items;
+    for (int i = 0; i < 10007; ++i) items.emplace_back((i * 7919) % 101, i);
+    auto expected = items;
+    auto byFirst = [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    };
+    std::stable_sort(expected.begin(), expected.end(), byFirst);
+
+    for (size_t workers : {2, 3, 8}) {
+        ThreadPool pool(workers);
+        auto got = items;
+        parallelStableSort(got, byFirst, pool);
+        ASSERT_EQ(got, expected) << workers << " workers";
+    }
+}
+
+TEST(ThreadPoolSuite, LargeSortMatchesSequential) {
+    std::string code = R"(
+        nums = range(0, 50000, 1)
+        s = sort(nums)
+        println(s[0], " ", s[1], " ", s[2], " ", s[49999])
+        r = sort(range(50000, 0, -1))
+        println(r[0], " ", r[1], " ", r[49999])
+    )";
+
+    std::string outputs[2];
+    size_t workers[2] = {1, 4};
+    for (int i = 0; i < 2; ++i) {
+        std::istringstream input(code);
+        std::istringstream runtime;
+        std::ostringstream output;
+        ASSERT_TRUE(interpret(input, runtime, output,
+                              InterpreterOptions{.workers = workers[i]}));
+        outputs[i] = output.str();
+    }
+    ASSERT_EQ(outputs[0], "0 1 10 9999\n1 10 9999\n");
+    ASSERT_EQ(outputs[1], outputs[0]);
+}
+
+static bool runParallel(const std::string& code, std::string& out) {
+    std::istringstream input(code);
+    std::istringstream runtime;
+    std::ostringstream output;
+    bool ok =
+        interpret(input, runtime, output, InterpreterOptions{.workers = 4});
+    out = output.str();
+    return ok;
+}
+
+TEST(ThreadPoolSuite, ParallelMapMatchesMap) {
+    std::string code = R"(
+        offset = 100
+        collatz = function(n)
+            steps = 0
+            while n != 1
+                if n % 2 == 0 then n = n / 2 else n = 3 * n + 1 end if
+                steps += 1
+            end while
+            return steps + offset
+        end function
+        lst = range(1, 300, 1)
+        a = parallel_map(lst, collatz)
+        b = map(lst, collatz)
+        println(a == b, " ", a[26], " ", len(a))
+        println(parallel_map([], collatz), parallel_map(["ab", "c"], len))
+    )";
+    std::string out;
+    ASSERT_TRUE(runParallel(code, out));
+    ASSERT_EQ(out, "true 211 299\n[][2, 1]\n");
+}
+
+TEST(ThreadPoolSuite, ParallelMapWithOutputRunsSequentially) {
+    std::string code = R"(
+        show = function(x)
+            if x > 5 then print(x) end if
+            return x
+        end function
+        println(parallel_map(range(0, 10, 1), show))
+    )";
+    std::string out;
+    ASSERT_TRUE(runParallel(code, out));
+    ASSERT_EQ(out, "6789[0, 1, 2, 3, 4, 5, 6, 7, 8, 9]\n");
+}
+
+TEST(ThreadPoolSuite, ParallelMapReportsFirstError) {
+    std::string code = R"(
+        f = function(x)
+            if x == 3 then print("unreachable") end if
+            return 10 / (x - 1) + nil
+        end function
+        parallel_map(range(0, 100, 1), f)
+    )";
+    std::string out;
+    ASSERT_FALSE(runParallel(code, out));
+    ASSERT_EQ(out, "");
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <itmoscript/interpreter.h>
+#include <itmoscript/tracer.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+using namespace itmoscript;
+
+namespace {
+
+std::string trace(const std::string& code, Tracer& tracer,
+                  size_t workers = 1) {
+    InterpreterOptions options{.workers = workers, .tracer = &tracer};
+    std::istringstream input(code), runtime;
+    std::ostringstream output, json;
+    EXPECT_TRUE(interpret(input, runtime, output, options));
+    tracer.writeJson(json);
+    return json.str();
+}
+
+size_t occurrences(const std::string& s, const std::string& what) {
+    size_t n = 0;
+    for (size_t at = s.find(what); at != std::string::npos;
+         at = s.find(what, at + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+}  // namespace
+
+TEST(TracerSuite, RecordsScriptAndBuiltinCalls) {
+    std::string code = R"(
+        twice = function(x)
+            return x * 2
+        end function
+        i = 0
+        while i < 3
+            print(twice(i))
+            i = i + 1
+        end while
+    )";
+    Tracer tracer;
+    std::string json = trace(code, tracer);
+
+    ASSERT_TRUE(json.starts_with("{\"displayTimeUnit\":\"ms\""));
+    ASSERT_EQ(tracer.events(), 6);
+    ASSERT_EQ(occurrences(json, "{\"name\":\"twice\",\"cat\":\"script\","
+                                "\"ph\":\"X\""),
+              3);
+    ASSERT_EQ(occurrences(json, "{\"name\":\"print\",\"cat\":\"builtin\","
+                                "\"ph\":\"X\""),
+              3);
+}
+
+TEST(TracerSuite, RecordsCallsOnWorkerThreads) {
+    std::string code = R"(
+        sq = function(x)
+            return x * x
+        end function
+        r = parallel_map(range(0, 100, 1), sq)
+    )";
+    Tracer tracer;
+    std::string json = trace(code, tracer, 2);
+
+    ASSERT_EQ(occurrences(json, "\"name\":\"sq\""), 100);
+    ASSERT_EQ(occurrences(json, "\"name\":\"parallel_map\""), 1);
+}
+
+TEST(TracerSuite, DropsShortCalls) {
+    std::string code = R"(
+        quick = function() return 1 end function
+        slow = function()
+            i = 0
+            while i < 100000
+                i = i + 1
+            end while
+        end function
+        quick()
+        slow()
+    )";
+    Tracer tracer(std::chrono::microseconds(500));
+    std::string json = trace(code, tracer);
+
+    ASSERT_EQ(tracer.events(), 1);
+    ASSERT_NE(json.find("\"name\":\"slow\""), std::string::npos);
+}
@@ -19,3 +19,260 @@ TEST(TypesTestSuite, IntTest) {
     ASSERT_TRUE(interpret(input, output));
     ASSERT_EQ(output.str(), expected);
 }
+
+TEST(TypesTestSuite, StringRebindConcat) {
+    std::string code = R"(
+        s = "ab"
+        s = s + s
+        s = s + "c" - "bc"
+        print(s)
+    )";
+
+    std::string expected = "aba";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, StringRebindCalleeSeesOldValue) {
+    std::string code = R"(
+        size = function()
+            return len(s)
+        end function
+
+        s = "ab"
+        s = s + to_string(size())
+        print(s)
+    )";
+
+    std::string expected = "ab2";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, StringCompoundAssignment) {
+    std::string code = R"(
+        s = "ab"
+        t = s
+        s += "cd"
+        s -= "d"
+        s *= 2
+        print(s)
+        print(t)
+        lst = [1]
+        lst += [2]
+        lst *= 2
+        print(lst)
+    )";
+
+    std::string expected = "abcabcab[1, 2, 1, 2]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, StringRepetition) {
+    std::string code = R"(
+        print("ab" * 3)
+        print("ab" * 0)
+        print([1] * 2)
+    )";
+
+    std::string expected = "ababab[1, 1]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, ListSlices) {
+    std::string code = R"(
+        a = [1, 2, 3, 4, 5]
+        print(a[1:3])
+        print(a[:2])
+        print(a[3:])
+        print(a[-2:])
+        print(a[3:1])
+        b = a[1:4]
+        b = push(b, 9)
+        print(b)
+        print(a)
+    )";
+
+    std::string expected =
+        "[2, 3][1, 2][4, 5][4, 5][][2, 3, 4, 9][1, 2, 3, 4, 5]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, StringSlices) {
+    std::string code = R"(
+        s = "hello"
+        print(s[1:3])
+        print(s[:2])
+        print(s[-3:])
+        t = s[1:]
+        t += "!"
+        print(t)
+        print(s)
+        print(len(s[1:4]))
+    )";
+
+    std::string expected = "elhelloello!hello3";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, SliceViewsInLoopsAndBuiltins) {
+    std::string code = R"(
+        total = function(a)
+            if len(a) == 1 then
+                return a[0]
+            end if
+            mid = len(a) / 2
+            return total(a[:mid]) + total(a[mid:])
+        end function
+
+        print(total(range(0, 100, 1)))
+        for x in [1, 2, 3, 4][1:3]
+            print(x)
+        end for
+        print(join(split("a,b,c,d", ",")[1:3], "-"))
+    )";
+
+    std::string expected = "495023b-c";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, IntegersAreExact) {
+    std::string code = R"(
+        println(9007199254740993)
+        println(2 ^ 62 + 1)
+        println(3037000499 * 3037000499)
+        println(-9223372036854775807 - 1)
+        println(floor(2.7) + 9007199254740993)
+        x = 9007199254740991
+        x += 2
+        println(x)
+    )";
+
+    std::string expected =
+        "9007199254740993\n"
+        "4611686018427387905\n"
+        "9223372030926249001\n"
+        "-9223372036854775808\n"
+        "9007199254740995\n"
+        "9007199254740993\n";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, IntegerOverflowAndDivisionFallBackToDouble) {
+    std::string code = R"(
+        println(9223372036854775807 + 1)
+        println(2 ^ 64)
+        println(7 / 2)
+        println(6 / 3)
+        println(-7 % 3)
+        println(2 ^ -1)
+        println(1.5 * 2)
+        println(3 < 3.5)
+    )";
+
+    std::string expected =
+        "9223372036854775808\n"
+        "18446744073709551616\n"
+        "3.500000\n"
+        "2\n"
+        "-1\n"
+        "0.500000\n"
+        "3\n"
+        "true\n";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, BitwiseOperators) {
+    std::string code = R"(
+        println(12 & 10, " ", 12 | 10, " ", 12 xor 10)
+        println(1 << 62, " ", 1 << 64, " ", -16 >> 2, " ", -1 >> 70)
+        println(~0, " ", ~5, " ", 6 & -6)
+        println(1 + 2 << 3, " ", 1 | 2 == 3, " ", 5 & 3 xor 1 | 8)
+
+        // Fenwick tree prefix sums
+        n = 16
+        tree = [0] * (n + 1)
+        i = 1
+        while i <= n
+            j = i
+            while j <= n
+                tree = tree[:j] + [tree[j] + i] + tree[j + 1:]
+                j += j & -j
+            end while
+            i += 1
+        end while
+        s = 0
+        k = 10
+        while k > 0
+            s += tree[k]
+            k -= k & -k
+        end while
+        println(s)
+    )";
+
+    std::string expected =
+        "8 14 6\n"
+        "4611686018427387904 0 -4 -1\n"
+        "-1 -6 2\n"
+        "24 true 8\n"
+        "55\n";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(TypesTestSuite, BitwiseOperatorsRequireIntegers) {
+    for (std::string expr : {"1.5 & 1", "\"a\" | 1", "1 << -1", "~nil"}) {
+        std::istringstream input("x = " + expr + "\nprint(239)\n");
+        std::ostringstream output;
+
+        ASSERT_FALSE(interpret(input, output)) << expr;
+        ASSERT_EQ(output.str(), "");
+    }
+}